@@ -12,14 +12,62 @@
 extern "C" {
 #endif
 
+// ============================================================================
+// CODIGOS DE RETORNO
+// ============================================================================
+//
+// Ninguna funcion trunca un resultado JSON. Si resultado_json no alcanza:
+//  - Consultas sin efectos persistentes (frases, identificar, evaluar,
+//    estadisticas, uuid, resultados de trabajos): retornan
+//    VOZ_ERROR_BUFFER_PEQUENO, escriben '\0' en el primer byte (si
+//    buffer_size > 0) y pueden repetirse con un buffer mayor.
+//  - Operaciones cuyo efecto ya quedo confirmado (registro, reentrenamiento,
+//    stream_finish, sync y autenticacion, que guarda la validacion): retornan
+//    su codigo normal, nunca VOZ_ERROR_BUFFER_PEQUENO, para que el llamador
+//    no las repita (ej: un registro duplicado). El buffer recibe
+//    {"truncado": true, "tamano_requerido": n, "id_resultado": k} y el JSON
+//    completo se lee con voz_mobile_copiar_resultado(k, ...). El id es
+//    unico por llamada, asi que otro hilo, isolate o contexto no puede
+//    recibir ese resultado. Estas operaciones exigen buffer_size >=
+//    VOZ_BUFFER_MINIMO: con menos retornan -1 sin ejecutar nada.
+// El resultado de un trabajo queda en el trabajo hasta que se libera.
+
+/** Codigo de retorno cuando el buffer del llamador es insuficiente */
+#define VOZ_ERROR_BUFFER_PEQUENO -2
+
+/** buffer_size minimo de las operaciones con efecto (cabe el JSON truncado) */
+#define VOZ_BUFFER_MINIMO 128
+
 // ============================================================================
 // GESTION DE LIBRERIA
 // ============================================================================
 
 /**
  * Inicializar la libreria biometrica
+ * Construye una sola vez el plan FFT (twiddles), la ventana, el banco mel
+ * disperso y la matriz DCT que reutilizan todas las extracciones.
+ * Arranque en caliente: tras el primer init exitoso se escribe un snapshot
+ * binario (<model_path>/voz_snapshot.bin) con el modelo, las estadisticas de
+ * cohorte y el dataset ya parseados, checksum por seccion y la huella
+ * (ruta, inodo, tamaño, mtime) de cada archivo fuente. Para modelo_voz.vzpk
+ * la huella incluye ademas checksum y model_version de su cabecera (se leen
+ * 96 bytes), asi un paquete reescrito con igual tamaño y mtime de grano
+ * grueso tambien invalida el snapshot. Los init siguientes lo mapean con
+ * mmap si la huella coincide; si algun archivo cambio o el checksum falla,
+ * se cargan las fuentes y el snapshot se regenera.
+ * modelo_voz.vzpk es el almacenamiento canonico del modelo: init solo
+ * abre y mapea ese archivo, y todo escritor de la libreria (reentrenar,
+ * registro incremental, sync_modelo) escribe solo el paquete, con
+ * <ruta>.tmp + rename. Si model_path no tiene paquete, el primer init lo
+ * genera una vez desde metadata.json y class_<id>.bin (como
+ * voz_mobile_empaquetar_modelos); desde entonces esas fuentes se ignoran.
+ * Un modelo nuevo en formato de fuentes se despliega regenerando el paquete
+ * con pack_voice_models.py (--verificar detecta un paquete desactualizado
+ * respecto a sus fuentes) o borrando el .vzpk.
  * @param db_path Ruta a la base de datos SQLite local
- * @param model_path Ruta al directorio de modelos SVM
+ * @param model_path Ruta al directorio de modelos SVM con modelo_voz.vzpk (ver
+ *                   voz_model_pack.h), que se mapea con mmap; los pesos se usan
+ *                   sin copiar (float64, float16 o int8 segun su cabecera)
  * @param dataset_path Ruta al dataset procesado
  * @return 0 si exito, -1 si error
  */
@@ -38,6 +86,147 @@ void voz_mobile_cleanup();
  */
 const char* voz_mobile_version();
 
+/**
+ * Configurar la cantidad de hilos de trabajo para extraccion de caracteristicas
+ * @param num_hilos Hilos a usar; 0 = cantidad de nucleos disponibles
+ * @return Cantidad de hilos efectiva, -1 si error
+ */
+int voz_mobile_configurar_hilos(int num_hilos);
+
+/**
+ * Configurar el tamaño de la arena de trabajo por contexto
+ * Decodificacion, tramas, MFCC, puntuacion y armado del resultado usan una
+ * arena (bump allocator) que se reinicia al final de cada peticion; solo se
+ * pide memoria al sistema si una peticion excede la capacidad, y la arena
+ * crece para las siguientes.
+ * @param bytes Capacidad inicial (0 = por defecto, 1 MB)
+ * @return 0 si exito, -1 si error
+ */
+int voz_mobile_configurar_arena(size_t bytes);
+
+/**
+ * Contador de asignaciones de heap hechas por la libreria desde el arranque
+ * Sirve para comprobar que voz_mobile_autenticar no asigna en estado estable
+ * (el contador no cambia entre dos llamadas). Solo disponible si la libreria
+ * se compila con VOZ_MOBILE_CONTAR_ASIGNACIONES.
+ * @return Cantidad de asignaciones, -1 si el contador no esta compilado
+ */
+int64_t voz_mobile_contador_asignaciones();
+
+/** Implementaciones del extractor MFCC */
+#define VOZ_EXTRACTOR_OPTIMIZADO    0   // Planes precalculados + kernels SIMD por bloques de tramas
+#define VOZ_EXTRACTOR_REFERENCIA    1   // Ruta original trama a trama (para comparar)
+
+/**
+ * Seleccionar la implementacion del extractor MFCC
+ * Pensado para benchmarks y pruebas de tolerancia; en produccion se usa
+ * VOZ_EXTRACTOR_OPTIMIZADO.
+ * @param extractor VOZ_EXTRACTOR_*
+ * @return 0 si exito, -1 si valor invalido
+ */
+int voz_mobile_seleccionar_extractor(int extractor);
+
+/**
+ * Extraer solo el vector de caracteristicas de un WAV (sin clasificar ni guardar)
+ * @param audio_path Ruta al archivo de audio WAV
+ * @param vector Buffer donde se copiara el vector
+ * @param dimension Tamaño de vector (debe ser >= dimension del modelo, 250)
+ * @param tiempo_us Si no es NULL, recibe el tiempo de extraccion en microsegundos
+ * @return Cantidad de valores escritos, -1 si error
+ */
+int voz_mobile_extraer_caracteristicas(const char* audio_path,
+                                       double* vector,
+                                       size_t dimension,
+                                       int64_t* tiempo_us);
+
+/** Modos de deteccion de actividad de voz (VAD) */
+#define VOZ_VAD_DESACTIVADO     0
+#define VOZ_VAD_ENERGIA_ZCR     1   // Energia por trama + tasa de cruces por cero
+#define VOZ_VAD_FLUJO_ESPECTRAL 2   // Flujo espectral (mas robusto con ruido estacionario)
+
+/**
+ * Configurar la deteccion de actividad de voz previa a MFCC
+ * Las tramas sin voz (silencio inicial/final y pausas) se descartan antes de
+ * la FFT y el banco mel. Los resultados de registro/autenticacion incluyen
+ * "vad": {"tramas_totales": n, "tramas_conservadas": k, "ratio_conservado": k/n}.
+ * Si quedan menos de min_tramas tramas con voz se usan todas las tramas.
+ * En sesiones de streaming el maximo de la grabacion no se conoce hasta el
+ * final; ahi se usa el umbral de voz_mobile_configurar_vad_stream.
+ * @param modo VOZ_VAD_* (por defecto VOZ_VAD_ENERGIA_ZCR)
+ * @param umbral_db Umbral de energia relativo al maximo de la grabacion, en dB (ej: -35.0)
+ * @param hangover_tramas Tramas que se conservan tras el fin de voz (ej: 5)
+ * @param min_tramas Minimo de tramas con voz para aplicar el recorte (ej: 20)
+ * @return 0 si exito, -1 si parametros invalidos
+ */
+int voz_mobile_configurar_vad(int modo,
+                              double umbral_db,
+                              int hangover_tramas,
+                              int min_tramas);
+
+/**
+ * Configurar el umbral del VAD para sesiones de streaming
+ * La decision por trama se toma al procesarla, relativa a un piso de ruido:
+ * se estima con la energia minima de las primeras tramas_ruido tramas y
+ * luego se actualiza con una media exponencial de las tramas sin voz. Una
+ * trama tiene voz si su energia supera piso + margen_db. El modo, el
+ * hangover y min_tramas son los de voz_mobile_configurar_vad; si al cerrar
+ * quedan menos de min_tramas con voz se usan todas las tramas acumuladas.
+ * @param margen_db Margen sobre el piso de ruido, en dB (ej: 12.0)
+ * @param tramas_ruido Tramas iniciales para estimar el piso (ej: 10 = 100 ms)
+ * @return 0 si exito, -1 si parametros invalidos
+ */
+int voz_mobile_configurar_vad_stream(double margen_db, int tramas_ruido);
+
+/**
+ * Configurar el presupuesto de memoria del modelo (llamar antes de voz_mobile_init)
+ * Sin presupuesto cada autenticacion puntua todas las filas de
+ * modelo_voz.vzpk, por lo que todas sus paginas terminan residentes y la RSS
+ * crece linealmente con la cantidad de clases.
+ * Con presupuesto > 0 autenticar puntua la clase reclamada y una cohorte
+ * fija de clases repartidas uniformemente sobre class_ids, elegida en init
+ * con tantas filas como quepan en la mitad del presupuesto. Las filas de la
+ * cohorte quedan residentes; las de las clases reclamadas se mantienen en un
+ * LRU acotado por la otra mitad, y al expulsar una fila su rango del mapeo
+ * se libera con madvise(MADV_DONTNEED), asi deja de contar en la RSS aunque
+ * el archivo siga en el page cache del sistema. Si el presupuesto no alcanza
+ * para dos filas, init falla.
+ * En ese modo "top_impostores", clase_predicha y VOZ_NORM_TNORM usan solo la
+ * cohorte (mas la clase reclamada), VOZ_NORM_ZNORM no cambia porque sus
+ * estadisticas estan en el paquete, y el JSON incluye
+ * "puntuacion_parcial": true y "tamano_cohorte". voz_mobile_identificar y
+ * voz_mobile_evaluar necesitan todas las clases: recorren la matriz por
+ * bloques y liberan cada bloque con madvise al terminarlo, sin poblar el LRU.
+ * Las estadisticas incluyen "cache_modelos": {"cohorte", "residentes",
+ * "bytes", "presupuesto_bytes", "hits", "misses", "expulsiones"}.
+ * @param presupuesto_bytes Memoria maxima para filas residentes del modelo (0 = sin limite)
+ * @return 0 si exito, -1 si error
+ */
+int voz_mobile_configurar_cache_modelos(size_t presupuesto_bytes);
+
+/**
+ * Habilitar o deshabilitar el snapshot de arranque (llamar antes de voz_mobile_init)
+ * @param habilitado 1 = usar y regenerar el snapshot (por defecto), 0 = cargar siempre las fuentes
+ * @param ruta Ruta del snapshot (NULL = <model_path>/voz_snapshot.bin)
+ * @return 0 si exito, -1 si error
+ */
+int voz_mobile_configurar_snapshot(int habilitado, const char* ruta);
+
+/**
+ * Borrar el snapshot de arranque para forzar su regeneracion en el proximo init
+ * @return 0 si exito (o si no existia), -1 si error
+ */
+int voz_mobile_invalidar_snapshot();
+
+/**
+ * Empaquetar metadata.json + class_<id>.bin en un unico modelo_voz.vzpk
+ * El archivo se escribe en <output_path>.tmp y solo se renombra si pasa la
+ * misma validacion que hace el loader.
+ * @param model_dir Directorio con metadata.json y class_<id>.bin
+ * @param output_path Ruta del .vzpk a generar (NULL = <model_dir>/modelo_voz.vzpk)
+ * @return Cantidad de clases empaquetadas, -1 si error
+ */
+int voz_mobile_empaquetar_modelos(const char* model_dir, const char* output_path);
+
 // ============================================================================
 // USUARIOS
 // ============================================================================
@@ -71,7 +260,7 @@ int voz_mobile_usuario_existe(const char* identificador);
  * Obtener frase aleatoria activa
  * @param buffer Buffer donde se copiara la frase
  * @param buffer_size Tamaño del buffer
- * @return ID de la frase seleccionada, -1 si error
+ * @return ID de la frase seleccionada, -1 si error, VOZ_ERROR_BUFFER_PEQUENO si el buffer no alcanza
  */
 int voz_mobile_obtener_frase_aleatoria(char* buffer, size_t buffer_size);
 
@@ -80,7 +269,7 @@ int voz_mobile_obtener_frase_aleatoria(char* buffer, size_t buffer_size);
  * @param id_frase ID de la frase
  * @param buffer Buffer donde se copiara la frase
  * @param buffer_size Tamaño del buffer
- * @return 0 si exito, -1 si error
+ * @return 0 si exito, -1 si error, VOZ_ERROR_BUFFER_PEQUENO si el buffer no alcanza
  */
 int voz_mobile_obtener_frase_por_id(int id_frase, char* buffer, size_t buffer_size);
 
@@ -97,12 +286,14 @@ int voz_mobile_insertar_frases(const char* frases_json);
 
 /**
  * Registrar biometria de voz
+ * Reentrena el modelo completo con voz_mobile_reentrenar_modelo.
  * @param identificador Cedula del usuario
  * @param audio_path Ruta al archivo de audio WAV (temporal)
  * @param id_frase ID de la frase pronunciada
  * @param resultado_json Buffer donde se copiara el resultado JSON
  * @param buffer_size Tamaño del buffer de resultado
  * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
  */
 int voz_mobile_registrar_biometria(const char* identificador,
                                     const char* audio_path,
@@ -112,14 +303,49 @@ int voz_mobile_registrar_biometria(const char* identificador,
 
 /**
  * Registrar biometria de voz usando ENTRENAMIENTO INCREMENTAL (más rápido)
- * Solo entrena el clasificador del nuevo usuario sin reentrenar todo el modelo.
- * Ideal para apps mobile donde el reentrenamiento completo es muy pesado.
+ * Actualizacion online (pasos Pegasos con arranque en caliente):
+ *  - el clasificador del usuario parte de sus pesos actuales (o de cero si es
+ *    nuevo) y da unos pasos con el nuevo vector como positivo y las medias
+ *    cacheadas de las demas clases como negativos (una por clase);
+ *  - los clasificadores existentes cuyo score sobre el nuevo vector supera el
+ *    margen reciben un paso con el como negativo.
+ * Las medias y su cantidad de muestras salen del bloque means del .vzpk
+ * (ver voz_model_pack.h) y la del usuario se actualiza con el nuevo vector;
+ * no se lee el dataset completo, por lo que el costo por registro es
+ * acotado e independiente del tamaño del dataset. Si el paquete no trae
+ * medias, el primer registro incremental las calcula una sola vez con una
+ * pasada por <dataset_path>/caracteristicas_train.dat y las guarda en el
+ * paquete junto con la actualizacion. Si tampoco hay dataset se hace lo
+ * mismo que antes de existir las medias: solo se entrena la clase del
+ * usuario y el JSON incluye "sin_medias": true.
+ * Con pesos float16 o int8 las filas actualizadas se calculan en float64
+ * sobre los pesos decodificados y se vuelven a cuantizar con la misma regla
+ * que pack_voice_models.py (redondeo a half; escala por fila recalculada
+ * para int8). La compuerta de precision no se repite online: el error de
+ * recuantizar se acumula hasta el siguiente voz_mobile_reentrenar_modelo.
+ * Las estadisticas Z-norm se actualizan en el mismo paso:
+ *  - clases cuyos pesos cambiaron (la del usuario y las que recibieron un
+ *    paso negativo): la media de impostores se recalcula con las medias
+ *    por clase, media = sum_j n_j (w . mu_j + b) / sum_j n_j, en
+ *    O(clases x dimension) y con los pesos decodificados en float64. Con
+ *    float64 y float16 el score es lineal en el vector y la media es
+ *    exacta; con int8 es aproximada, porque la entrada se cuantiza por
+ *    request y eso no es lineal. La desviacion se conserva (una clase
+ *    nueva toma la mediana de las demas) y el JSON marca
+ *    "znorm_aproximado": true;
+ *  - clases sin cambios: el nuevo vector se acumula (Welford) como impostor.
+ * voz_mobile_reentrenar_modelo recalcula todas las estadisticas desde el
+ * dataset y limpia la marca.
+ * Cada actualizacion incrementa la version del modelo (ver
+ * voz_mobile_obtener_version_modelo); el JSON incluye "version_modelo" y
+ * "clases_actualizadas".
  * @param identificador Cedula del usuario
  * @param audio_path Ruta al archivo de audio WAV (temporal)
  * @param id_frase ID de la frase pronunciada
  * @param resultado_json Buffer donde se copiara el resultado JSON
  * @param buffer_size Tamaño del buffer de resultado
  * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
  */
 int voz_mobile_registrar_biometria_incremental(const char* identificador,
                                                 const char* audio_path,
@@ -131,12 +357,18 @@ int voz_mobile_registrar_biometria_incremental(const char* identificador,
  * Registrar biometria de voz en BATCH (ULTRA OPTIMIZADO)
  * Procesa TODOS los audios y entrena SOLO UNA VEZ al final.
  * Evita re-entrenar el modelo por cada audio (O(n²) -> O(n)).
+ * La decodificacion + MFCC de cada audio corre en paralelo (ver
+ * voz_mobile_configurar_hilos); los vectores se recogen en el orden de
+ * audio_paths antes del entrenamiento, asi que el resultado es determinista.
+ * El JSON incluye "tiempos_por_audio": [{"audio": i, "extraccion_ms": t}, ...]
+ * y "entrenamiento_ms".
  * @param identificador Cedula del usuario
  * @param audio_paths Array de rutas a archivos WAV
  * @param num_audios Cantidad de audios en el array
  * @param resultado_json Buffer donde se copiara el resultado JSON
  * @param buffer_size Tamaño del buffer de resultado
  * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
  */
 int voz_mobile_registrar_biometria_batch(const char* identificador,
                                           const char** audio_paths,
@@ -150,12 +382,18 @@ int voz_mobile_registrar_biometria_batch(const char* identificador,
 
 /**
  * Autenticar usuario por voz
+ * Todas las clases se puntuan en una sola pasada sobre la matriz de pesos;
+ * el JSON incluye "score" de la clase reclamada y "top_impostores"
+ * ([{"clase": id, "score": s}, ...], hasta VOZ_TOP_K_DEFAULT entradas).
+ * Excepcion: con presupuesto de memoria solo se puntuan la clase reclamada
+ * y una cohorte fija (ver voz_mobile_configurar_cache_modelos).
  * @param identificador Cedula del usuario
  * @param audio_path Ruta al archivo de audio WAV (temporal)
  * @param id_frase ID de la frase pronunciada
  * @param resultado_json Buffer donde se copiara el resultado JSON
  * @param buffer_size Tamaño del buffer de resultado
  * @return 1 si autenticado, 0 si rechazado, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
  */
 int voz_mobile_autenticar(const char* identificador,
                           const char* audio_path,
@@ -163,19 +401,762 @@ int voz_mobile_autenticar(const char* identificador,
                           char* resultado_json,
                           size_t buffer_size);
 
+/** Normalizacion de scores */
+#define VOZ_NORM_NINGUNA    0   // Score crudo del SVM
+#define VOZ_NORM_ZNORM      1   // (score - media_impostores) / desv_impostores, precalculado por clase
+#define VOZ_NORM_TNORM      2   // Normaliza con los scores de cohorte del mismo pase de puntuacion
+
+/**
+ * Configurar la normalizacion de scores usada en la decision
+ * Z-norm usa las estadisticas de impostores por clase calculadas al entrenar
+ * y guardadas en modelo_voz.vzpk (ver voz_model_pack.h); en autenticacion
+ * cuesta O(1). Tras un registro incremental las estadisticas de las clases
+ * modificadas se recalibran como se describe en
+ * voz_mobile_registrar_biometria_incremental. Si el modelo no las trae, se
+ * usa VOZ_NORM_NINGUNA.
+ * Los scores normalizados no estan en la escala del score crudo, por lo que
+ * el umbral de decision se configura aparte: con VOZ_NORM_NINGUNA se sigue
+ * usando el umbral del modelo y las decisiones no cambian.
+ * El JSON de autenticar incluye "score" (crudo) y "score_normalizado".
+ * @param modo VOZ_NORM_* (por defecto VOZ_NORM_NINGUNA)
+ * @param umbral Umbral sobre el score normalizado (ignorado con VOZ_NORM_NINGUNA)
+ * @return 0 si exito, -1 si modo invalido
+ */
+int voz_mobile_configurar_normalizacion(int modo, double umbral);
+
+/** Cantidad de impostores reportados por defecto en autenticar */
+#define VOZ_TOP_K_DEFAULT 5
+
+/**
+ * Identificar hablante (1:N) por voz
+ * Usa el mismo kernel de puntuacion que voz_mobile_autenticar, por lo que
+ * cuesta lo mismo que una verificacion 1:1.
+ * @param audio_path Ruta al archivo de audio WAV (temporal)
+ * @param top_k Cantidad de candidatos a devolver (<= 0 usa VOZ_TOP_K_DEFAULT)
+ * @param resultado_json Buffer donde se copiara el resultado JSON
+ *                       ({"candidatos": [{"clase": id, "identificador": "...", "score": s}, ...]})
+ * @param buffer_size Tamaño del buffer de resultado
+ * @return Clase con mayor score, -1 si error, VOZ_ERROR_BUFFER_PEQUENO si el buffer no alcanza
+ */
+int voz_mobile_identificar(const char* audio_path,
+                           int top_k,
+                           char* resultado_json,
+                           size_t buffer_size);
+
+/**
+ * Obtener el kernel de puntuacion seleccionado en tiempo de ejecucion
+ * @return "avx2", "neon" o "escalar"
+ */
+const char* voz_mobile_kernel_puntuacion();
+
+/**
+ * Obtener la precision de los pesos del modelo cargado
+ * Con int8 el vector de entrada se cuantiza por peticion y el producto
+ * punto se hace en enteros; la precision la fija el .vzpk desplegado
+ * (generado y validado con pack_voice_models.py --tipo).
+ * @return "f64", "f16" o "i8"
+ */
+const char* voz_mobile_precision_modelo();
+
+/**
+ * Reentrenar el modelo completo (one-vs-rest) desde caracteristicas_train.dat
+ * El dataset se lee una sola vez a una matriz compartida de solo lectura y
+ * las clases se reparten entre los hilos (ver voz_mobile_configurar_hilos).
+ * El modelo nuevo se escribe en <model_path>/modelo_voz.vzpk.tmp y se
+ * renombra al terminar, por lo que una autenticacion concurrente ve el
+ * modelo anterior o el nuevo, nunca uno a medias.
+ * Recalcula tambien las estadisticas Z-norm y las medias por clase.
+ * @param resultado_json Buffer donde se copiara el resultado JSON
+ *                       ({"clases": n, "muestras": m, "hilos": h, "entrenamiento_ms": t})
+ * @param buffer_size Tamaño del buffer de resultado
+ * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
+ */
+int voz_mobile_reentrenar_modelo(char* resultado_json, size_t buffer_size);
+
+/**
+ * Obtener la version del modelo cargado
+ * Se incrementa en cada registro incremental y en cada reentrenamiento.
+ * @return Version del modelo, -1 si no hay modelo cargado
+ */
+int64_t voz_mobile_obtener_version_modelo();
+
+// ============================================================================
+// AUDIO EN MEMORIA (PCM)
+// ============================================================================
+//
+// Variantes de registro/autenticacion que reciben las muestras directamente
+// desde el buffer de grabacion, sin escribir ni releer un WAV temporal.
+// El buffer pertenece al llamador y solo se lee durante la llamada.
+// Las muestras multicanal se esperan intercaladas (L R L R ...) y se
+// mezclan a mono; si sample_rate != 16000 se remuestrean internamente.
+
+/**
+ * Registrar biometria de voz desde PCM16 en memoria
+ * @param identificador Cedula del usuario
+ * @param samples Muestras PCM16 intercaladas
+ * @param num_samples Cantidad de muestras por canal (frames)
+ * @param sample_rate Frecuencia de muestreo en Hz (ej: 16000)
+ * @param channels Cantidad de canales (1 = mono)
+ * @param id_frase ID de la frase pronunciada
+ * @param resultado_json Buffer donde se copiara el resultado JSON
+ * @param buffer_size Tamaño del buffer de resultado
+ * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
+ */
+int voz_mobile_registrar_biometria_pcm(const char* identificador,
+                                       const int16_t* samples,
+                                       size_t num_samples,
+                                       int sample_rate,
+                                       int channels,
+                                       int id_frase,
+                                       char* resultado_json,
+                                       size_t buffer_size);
+
+/**
+ * Igual que voz_mobile_registrar_biometria_pcm con muestras float en [-1, 1]
+ */
+int voz_mobile_registrar_biometria_pcm_f32(const char* identificador,
+                                           const float* samples,
+                                           size_t num_samples,
+                                           int sample_rate,
+                                           int channels,
+                                           int id_frase,
+                                           char* resultado_json,
+                                           size_t buffer_size);
+
+/**
+ * Registrar biometria de voz INCREMENTAL desde PCM16 en memoria
+ * Parametros iguales a voz_mobile_registrar_biometria_pcm.
+ * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
+ */
+int voz_mobile_registrar_biometria_incremental_pcm(const char* identificador,
+                                                   const int16_t* samples,
+                                                   size_t num_samples,
+                                                   int sample_rate,
+                                                   int channels,
+                                                   int id_frase,
+                                                   char* resultado_json,
+                                                   size_t buffer_size);
+
+/**
+ * Igual que voz_mobile_registrar_biometria_incremental_pcm con muestras float en [-1, 1]
+ */
+int voz_mobile_registrar_biometria_incremental_pcm_f32(const char* identificador,
+                                                       const float* samples,
+                                                       size_t num_samples,
+                                                       int sample_rate,
+                                                       int channels,
+                                                       int id_frase,
+                                                       char* resultado_json,
+                                                       size_t buffer_size);
+
+/**
+ * Registrar biometria de voz en BATCH desde varios buffers PCM16
+ * Todos los audios comparten sample_rate y channels. Entrena una sola vez al final.
+ * @param identificador Cedula del usuario
+ * @param samples Array de punteros a muestras PCM16 (uno por audio)
+ * @param num_samples Array con la cantidad de frames de cada audio
+ * @param num_audios Cantidad de audios en los arrays
+ * @param sample_rate Frecuencia de muestreo en Hz
+ * @param channels Cantidad de canales
+ * @param resultado_json Buffer donde se copiara el resultado JSON
+ * @param buffer_size Tamaño del buffer de resultado
+ * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
+ */
+int voz_mobile_registrar_biometria_batch_pcm(const char* identificador,
+                                             const int16_t** samples,
+                                             const size_t* num_samples,
+                                             int num_audios,
+                                             int sample_rate,
+                                             int channels,
+                                             char* resultado_json,
+                                             size_t buffer_size);
+
+/**
+ * Igual que voz_mobile_registrar_biometria_batch_pcm con muestras float en [-1, 1]
+ */
+int voz_mobile_registrar_biometria_batch_pcm_f32(const char* identificador,
+                                                 const float** samples,
+                                                 const size_t* num_samples,
+                                                 int num_audios,
+                                                 int sample_rate,
+                                                 int channels,
+                                                 char* resultado_json,
+                                                 size_t buffer_size);
+
+/**
+ * Autenticar usuario por voz desde PCM16 en memoria
+ * @param identificador Cedula del usuario
+ * @param samples Muestras PCM16 intercaladas
+ * @param num_samples Cantidad de muestras por canal (frames)
+ * @param sample_rate Frecuencia de muestreo en Hz (ej: 16000)
+ * @param channels Cantidad de canales (1 = mono)
+ * @param id_frase ID de la frase pronunciada
+ * @param resultado_json Buffer donde se copiara el resultado JSON
+ * @param buffer_size Tamaño del buffer de resultado
+ * @return 1 si autenticado, 0 si rechazado, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
+ */
+int voz_mobile_autenticar_pcm(const char* identificador,
+                              const int16_t* samples,
+                              size_t num_samples,
+                              int sample_rate,
+                              int channels,
+                              int id_frase,
+                              char* resultado_json,
+                              size_t buffer_size);
+
+/**
+ * Igual que voz_mobile_autenticar_pcm con muestras float en [-1, 1]
+ */
+int voz_mobile_autenticar_pcm_f32(const char* identificador,
+                                  const float* samples,
+                                  size_t num_samples,
+                                  int sample_rate,
+                                  int channels,
+                                  int id_frase,
+                                  char* resultado_json,
+                                  size_t buffer_size);
+
+/**
+ * Identificar hablante (1:N) desde PCM16 en memoria
+ * @param samples Muestras PCM16 intercaladas
+ * @param num_samples Cantidad de muestras por canal (frames)
+ * @param sample_rate Frecuencia de muestreo en Hz
+ * @param channels Cantidad de canales
+ * @param top_k Cantidad de candidatos a devolver (<= 0 usa VOZ_TOP_K_DEFAULT)
+ * @param resultado_json Buffer donde se copiara el resultado JSON
+ * @param buffer_size Tamaño del buffer de resultado
+ * @return Clase con mayor score, -1 si error, VOZ_ERROR_BUFFER_PEQUENO si el buffer no alcanza
+ */
+int voz_mobile_identificar_pcm(const int16_t* samples,
+                               size_t num_samples,
+                               int sample_rate,
+                               int channels,
+                               int top_k,
+                               char* resultado_json,
+                               size_t buffer_size);
+
+// ============================================================================
+// EXTRACCION EN STREAMING (DURANTE LA GRABACION)
+// ============================================================================
+//
+// Sesion que procesa el audio por bloques mientras se graba: cada push
+// completa las tramas que alcanza (ventana, FFT, banco mel, DCT) y acumula
+// sus estadisticas, de modo que al llamar a finish solo falta la ultima
+// trama parcial, el vector de 250 dimensiones y la decision SVM.
+// El VAD decide cada trama contra el piso de ruido (ver
+// voz_mobile_configurar_vad_stream), no contra el maximo de la grabacion.
+// Una sesion no es thread-safe: push/finish deben llamarse desde el mismo hilo.
+
+/** Sesion de extraccion en streaming (opaca) */
+typedef struct voz_mobile_stream voz_mobile_stream;
+
+/** Operacion que se ejecuta al cerrar la sesion */
+#define VOZ_STREAM_AUTENTICAR               0
+#define VOZ_STREAM_REGISTRAR                1
+#define VOZ_STREAM_REGISTRAR_INCREMENTAL    2
+
+/**
+ * Abrir una sesion de streaming
+ * @param identificador Cedula del usuario
+ * @param id_frase ID de la frase pronunciada
+ * @param operacion VOZ_STREAM_AUTENTICAR, VOZ_STREAM_REGISTRAR o VOZ_STREAM_REGISTRAR_INCREMENTAL
+ * @param sample_rate Frecuencia de muestreo en Hz (ej: 16000)
+ * @param channels Cantidad de canales (1 = mono)
+ * @return Sesion abierta, NULL si error
+ */
+voz_mobile_stream* voz_mobile_stream_begin(const char* identificador,
+                                           int id_frase,
+                                           int operacion,
+                                           int sample_rate,
+                                           int channels);
+
+/**
+ * Agregar un bloque de muestras PCM16 a la sesion
+ * El buffer se procesa durante la llamada y no se retiene.
+ * @param session Sesion abierta con voz_mobile_stream_begin
+ * @param samples Muestras PCM16 intercaladas
+ * @param num_samples Cantidad de muestras por canal (frames)
+ * @return Cantidad de tramas MFCC procesadas hasta ahora, -1 si error
+ */
+int voz_mobile_stream_push(voz_mobile_stream* session,
+                           const int16_t* samples,
+                           size_t num_samples);
+
+/**
+ * Igual que voz_mobile_stream_push con muestras float en [-1, 1]
+ */
+int voz_mobile_stream_push_f32(voz_mobile_stream* session,
+                               const float* samples,
+                               size_t num_samples);
+
+/**
+ * Cerrar la sesion: completa el vector de caracteristicas y ejecuta la operacion
+ * La sesion se libera siempre, incluso si hay error.
+ * @param session Sesion abierta con voz_mobile_stream_begin
+ * @param resultado_json Buffer donde se copiara el resultado JSON
+ * @param buffer_size Tamaño del buffer de resultado
+ * @return Igual que la operacion: autenticar 1/0/-1, registrar 0/-1
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
+ */
+int voz_mobile_stream_finish(voz_mobile_stream* session,
+                             char* resultado_json,
+                             size_t buffer_size);
+
+/**
+ * Descartar una sesion sin ejecutar la operacion (ej: grabacion cancelada)
+ * @param session Sesion a liberar (NULL se ignora)
+ */
+void voz_mobile_stream_cancel(voz_mobile_stream* session);
+
+// ============================================================================
+// EVALUACION OFFLINE
+// ============================================================================
+
+/**
+ * Evaluar el modelo cargado sobre un archivo de caracteristicas
+ * El archivo (formato caracteristicas_*.dat: uint32 dim, double x[dim],
+ * int32 clase por registro) se mapea con mmap y cada vector se puntua contra
+ * todas las clases en paralelo (ver voz_mobile_configurar_hilos).
+ * resultado_json recibe el resumen:
+ *   {"muestras", "accuracy", "eer", "umbral_eer", "far_en_umbral", "frr_en_umbral", "tiempo_ms"}
+ * Si reporte_path no es NULL se escribe ademas el reporte completo:
+ *   "confusion": [[clase_real, clase_predicha, cantidad], ...] (solo celdas != 0)
+ *   "roc": [{"umbral", "far", "frr"}, ...] (num_puntos_roc puntos, sirve tambien como curva DET)
+ * @param features_path Ruta a caracteristicas_test.dat (o train.dat)
+ * @param num_puntos_roc Puntos de la curva ROC/DET (<= 0 usa 100)
+ * @param reporte_path Ruta del JSON con el reporte completo (NULL = solo resumen)
+ * @param resultado_json Buffer donde se copiara el resumen JSON
+ * @param buffer_size Tamaño del buffer
+ * @return Cantidad de muestras evaluadas, -1 si error, VOZ_ERROR_BUFFER_PEQUENO si el buffer no alcanza
+ */
+int voz_mobile_evaluar(const char* features_path,
+                       int num_puntos_roc,
+                       const char* reporte_path,
+                       char* resultado_json,
+                       size_t buffer_size);
+
+// ============================================================================
+// RESULTADOS BINARIOS
+// ============================================================================
+//
+// Alternativa sin JSON para la ruta caliente: el resultado se escribe en un
+// struct del llamador (mapeable con dart:ffi Struct). El llamador debe poner
+// struct_size = sizeof(struct) antes de la llamada; la libreria solo escribe
+// los campos que caben, asi versiones nuevas pueden agregar campos al final.
+
+/** Maximo de candidatos/impostores que caben en un resultado binario */
+#define VOZ_MAX_TOP_K 16
+
+/** Par clase/score */
+typedef struct voz_candidato {
+    int32_t clase;
+    int32_t reservado;
+    double score;
+} voz_candidato;
+
+/** Tiempos por etapa de una peticion, en milisegundos */
+typedef struct voz_tiempos {
+    double decodificacion_ms;   // Lectura del WAV o conversion del PCM
+    double vad_ms;
+    double mfcc_ms;
+    double puntuacion_ms;
+    double db_ms;               // Encolar la validacion (carril prioritario, sin esperar el commit)
+    double total_ms;
+} voz_tiempos;
+
+/** Resultado de autenticacion 1:1 */
+typedef struct voz_resultado_auth {
+    uint32_t struct_size;       // sizeof(voz_resultado_auth), lo pone el llamador
+    int32_t autenticado;        // 1 si autenticado, 0 si rechazado
+    int32_t clase_reclamada;
+    int32_t clase_predicha;     // Clase con mayor score (entre reclamada y cohorte con puntuacion parcial)
+    double score;               // Score crudo de la clase reclamada
+    double score_normalizado;   // Igual a score si no hay normalizacion
+    double umbral;              // Umbral aplicado (del modelo o el normalizado configurado)
+    int32_t num_top_k;          // Entradas validas en top_impostores
+    int32_t reservado;
+    voz_candidato top_impostores[VOZ_MAX_TOP_K];
+    voz_tiempos tiempos;
+} voz_resultado_auth;
+
+/**
+ * Autenticar usuario por voz con resultado binario
+ * @param identificador Cedula del usuario
+ * @param audio_path Ruta al archivo de audio WAV (temporal)
+ * @param id_frase ID de la frase pronunciada
+ * @param resultado Struct del llamador con struct_size inicializado
+ * @return 1 si autenticado, 0 si rechazado, -1 si error
+ */
+int voz_mobile_autenticar_bin(const char* identificador,
+                              const char* audio_path,
+                              int id_frase,
+                              voz_resultado_auth* resultado);
+
+/**
+ * Autenticar usuario por voz desde PCM16 con resultado binario
+ * @return 1 si autenticado, 0 si rechazado, -1 si error
+ */
+int voz_mobile_autenticar_pcm_bin(const char* identificador,
+                                  const int16_t* samples,
+                                  size_t num_samples,
+                                  int sample_rate,
+                                  int channels,
+                                  int id_frase,
+                                  voz_resultado_auth* resultado);
+
+/**
+ * Identificar hablante (1:N) con resultado binario de largo variable
+ * Consulta de tamaño: con candidatos == NULL o capacidad == 0 solo se
+ * escribe *num_candidatos con la cantidad disponible y se retorna 0.
+ * @param audio_path Ruta al archivo de audio WAV (temporal)
+ * @param candidatos Array del llamador, ordenado por score descendente al volver
+ * @param capacidad Tamaño del array
+ * @param num_candidatos Recibe la cantidad de candidatos escritos (o disponibles)
+ * @param tiempos Si no es NULL, recibe los tiempos por etapa
+ * @return Clase con mayor score, 0 en consulta de tamaño, -1 si error
+ */
+int voz_mobile_identificar_bin(const char* audio_path,
+                               voz_candidato* candidatos,
+                               int capacidad,
+                               int* num_candidatos,
+                               voz_tiempos* tiempos);
+
+// ============================================================================
+// CONTEXTOS REENTRANTES
+// ============================================================================
+//
+// Cada voz_ctx tiene su propio scratch (buffers de audio, tramas, vector de
+// caracteristicas) y su propio ultimo error, por lo que varios hilos o
+// isolates pueden autenticar en paralelo usando un contexto cada uno.
+// Los modelos se comparten en solo lectura entre contextos con el mismo
+// model_path y se liberan al destruir el ultimo contexto que los usa.
+// Del mismo modo, todos los contextos con el mismo db_path (y el contexto
+// por defecto) comparten una conexion SQLite con un unico hilo escritor y
+// su pool de lectura, en lugar de abrir uno por contexto.
+// Un mismo contexto NO debe usarse desde dos hilos a la vez.
+// Las funciones globales voz_mobile_* operan sobre un contexto por defecto
+// creado en voz_mobile_init.
+//
+// Alcance: todas las funciones que usan scratch de audio tienen variante
+// voz_ctx_*: extraccion, registro, autenticacion e identificacion (desde
+// archivo, PCM16 o PCM float32, con resultado JSON o binario) y streaming.
+// Sincronizacion, trabajos asincronos, estadisticas, trazado y
+// configuracion (voz_mobile_configurar_*) son de toda la libreria: comparten
+// la cola de sync, el pool de trabajos y los histogramas, y no dependen del
+// scratch de un contexto, por lo que no tienen variante.
+// Las funciones voz_ctx_* guardan su error solo en el contexto; se lee con
+// voz_ctx_obtener_ultimo_error, no con voz_mobile_obtener_ultimo_error.
+
+/** Contexto de la libreria (opaco) */
+typedef struct voz_ctx voz_ctx;
+
+/**
+ * Crear un contexto
+ * @param db_path Ruta a la base de datos SQLite local
+ * @param model_path Ruta al directorio de modelos SVM
+ * @param dataset_path Ruta al dataset procesado
+ * @param error Si no es NULL, recibe el mensaje de error cuando se retorna
+ *              NULL (como no hay contexto, no se usa el error del hilo)
+ * @param error_size Tamaño del buffer error
+ * @return Contexto creado, NULL si error
+ */
+voz_ctx* voz_ctx_crear(const char* db_path,
+                       const char* model_path,
+                       const char* dataset_path,
+                       char* error,
+                       size_t error_size);
+
+/**
+ * Destruir un contexto y soltar su referencia a los modelos compartidos
+ * @param ctx Contexto a destruir (NULL se ignora)
+ */
+void voz_ctx_destruir(voz_ctx* ctx);
+
+/**
+ * Extraer el vector de caracteristicas de un audio usando un contexto
+ * Parametros y retorno iguales a voz_mobile_extraer_caracteristicas.
+ */
+int voz_ctx_extraer_caracteristicas(voz_ctx* ctx,
+                                    const char* audio_path,
+                                    double* vector,
+                                    size_t dimension,
+                                    int64_t* tiempo_us);
+
+/**
+ * Autenticar usuario por voz usando un contexto
+ * Parametros y retorno iguales a voz_mobile_autenticar.
+ */
+int voz_ctx_autenticar(voz_ctx* ctx,
+                       const char* identificador,
+                       const char* audio_path,
+                       int id_frase,
+                       char* resultado_json,
+                       size_t buffer_size);
+
+/**
+ * Autenticar usuario por voz desde PCM16 usando un contexto
+ * Parametros y retorno iguales a voz_mobile_autenticar_pcm.
+ */
+int voz_ctx_autenticar_pcm(voz_ctx* ctx,
+                           const char* identificador,
+                           const int16_t* samples,
+                           size_t num_samples,
+                           int sample_rate,
+                           int channels,
+                           int id_frase,
+                           char* resultado_json,
+                           size_t buffer_size);
+
+/**
+ * Autenticar usuario por voz desde PCM float32 usando un contexto
+ * Parametros y retorno iguales a voz_mobile_autenticar_pcm_f32.
+ */
+int voz_ctx_autenticar_pcm_f32(voz_ctx* ctx,
+                               const char* identificador,
+                               const float* samples,
+                               size_t num_samples,
+                               int sample_rate,
+                               int channels,
+                               int id_frase,
+                               char* resultado_json,
+                               size_t buffer_size);
+
+/**
+ * Identificar hablante (1:N) usando un contexto
+ * Parametros y retorno iguales a voz_mobile_identificar.
+ */
+int voz_ctx_identificar(voz_ctx* ctx,
+                        const char* audio_path,
+                        int top_k,
+                        char* resultado_json,
+                        size_t buffer_size);
+
+/**
+ * Identificar hablante (1:N) desde PCM16 usando un contexto
+ * Parametros y retorno iguales a voz_mobile_identificar_pcm.
+ */
+int voz_ctx_identificar_pcm(voz_ctx* ctx,
+                            const int16_t* samples,
+                            size_t num_samples,
+                            int sample_rate,
+                            int channels,
+                            int top_k,
+                            char* resultado_json,
+                            size_t buffer_size);
+
+/**
+ * Identificar hablante (1:N) con resultado binario usando un contexto
+ * Parametros y retorno iguales a voz_mobile_identificar_bin.
+ */
+int voz_ctx_identificar_bin(voz_ctx* ctx,
+                            const char* audio_path,
+                            voz_candidato* candidatos,
+                            int capacidad,
+                            int* num_candidatos,
+                            voz_tiempos* tiempos);
+
+/**
+ * Autenticar usuario por voz con resultado binario usando un contexto
+ * Parametros y retorno iguales a voz_mobile_autenticar_bin.
+ */
+int voz_ctx_autenticar_bin(voz_ctx* ctx,
+                           const char* identificador,
+                           const char* audio_path,
+                           int id_frase,
+                           voz_resultado_auth* resultado);
+
+/**
+ * Autenticar usuario por voz desde PCM16 con resultado binario usando un contexto
+ * Parametros y retorno iguales a voz_mobile_autenticar_pcm_bin.
+ */
+int voz_ctx_autenticar_pcm_bin(voz_ctx* ctx,
+                               const char* identificador,
+                               const int16_t* samples,
+                               size_t num_samples,
+                               int sample_rate,
+                               int channels,
+                               int id_frase,
+                               voz_resultado_auth* resultado);
+
+/**
+ * Registrar biometria de voz (reentrenamiento completo) usando un contexto
+ * Parametros y retorno iguales a voz_mobile_registrar_biometria.
+ * Las actualizaciones del modelo se publican a los demas contextos al terminar.
+ */
+int voz_ctx_registrar_biometria(voz_ctx* ctx,
+                                const char* identificador,
+                                const char* audio_path,
+                                int id_frase,
+                                char* resultado_json,
+                                size_t buffer_size);
+
+/**
+ * Registrar biometria de voz desde PCM16 usando un contexto
+ * Parametros y retorno iguales a voz_mobile_registrar_biometria_pcm.
+ */
+int voz_ctx_registrar_biometria_pcm(voz_ctx* ctx,
+                                    const char* identificador,
+                                    const int16_t* samples,
+                                    size_t num_samples,
+                                    int sample_rate,
+                                    int channels,
+                                    int id_frase,
+                                    char* resultado_json,
+                                    size_t buffer_size);
+
+/**
+ * Registrar biometria de voz desde PCM float32 usando un contexto
+ * Parametros y retorno iguales a voz_mobile_registrar_biometria_pcm_f32.
+ */
+int voz_ctx_registrar_biometria_pcm_f32(voz_ctx* ctx,
+                                        const char* identificador,
+                                        const float* samples,
+                                        size_t num_samples,
+                                        int sample_rate,
+                                        int channels,
+                                        int id_frase,
+                                        char* resultado_json,
+                                        size_t buffer_size);
+
+/**
+ * Registrar biometria de voz (incremental) usando un contexto
+ * Parametros y retorno iguales a voz_mobile_registrar_biometria_incremental.
+ * Las actualizaciones del modelo se publican a los demas contextos al terminar.
+ */
+int voz_ctx_registrar_biometria_incremental(voz_ctx* ctx,
+                                            const char* identificador,
+                                            const char* audio_path,
+                                            int id_frase,
+                                            char* resultado_json,
+                                            size_t buffer_size);
+
+/**
+ * Registrar biometria de voz (incremental) desde PCM16 usando un contexto
+ * Parametros y retorno iguales a voz_mobile_registrar_biometria_incremental_pcm.
+ */
+int voz_ctx_registrar_biometria_incremental_pcm(voz_ctx* ctx,
+                                                const char* identificador,
+                                                const int16_t* samples,
+                                                size_t num_samples,
+                                                int sample_rate,
+                                                int channels,
+                                                int id_frase,
+                                                char* resultado_json,
+                                                size_t buffer_size);
+
+/**
+ * Registrar biometria de voz (incremental) desde PCM float32 usando un contexto
+ * Parametros y retorno iguales a voz_mobile_registrar_biometria_incremental_pcm_f32.
+ */
+int voz_ctx_registrar_biometria_incremental_pcm_f32(voz_ctx* ctx,
+                                                    const char* identificador,
+                                                    const float* samples,
+                                                    size_t num_samples,
+                                                    int sample_rate,
+                                                    int channels,
+                                                    int id_frase,
+                                                    char* resultado_json,
+                                                    size_t buffer_size);
+
+/**
+ * Registrar biometria de voz en BATCH usando un contexto
+ * Parametros y retorno iguales a voz_mobile_registrar_biometria_batch.
+ */
+int voz_ctx_registrar_biometria_batch(voz_ctx* ctx,
+                                      const char* identificador,
+                                      const char** audio_paths,
+                                      int num_audios,
+                                      char* resultado_json,
+                                      size_t buffer_size);
+
+/**
+ * Registrar biometria de voz en BATCH desde PCM16 usando un contexto
+ * Parametros y retorno iguales a voz_mobile_registrar_biometria_batch_pcm.
+ */
+int voz_ctx_registrar_biometria_batch_pcm(voz_ctx* ctx,
+                                          const char* identificador,
+                                          const int16_t** samples,
+                                          const size_t* num_samples,
+                                          int num_audios,
+                                          int sample_rate,
+                                          int channels,
+                                          char* resultado_json,
+                                          size_t buffer_size);
+
+/**
+ * Registrar biometria de voz en BATCH desde PCM float32 usando un contexto
+ * Parametros y retorno iguales a voz_mobile_registrar_biometria_batch_pcm_f32.
+ */
+int voz_ctx_registrar_biometria_batch_pcm_f32(voz_ctx* ctx,
+                                              const char* identificador,
+                                              const float** samples,
+                                              const size_t* num_samples,
+                                              int num_audios,
+                                              int sample_rate,
+                                              int channels,
+                                              char* resultado_json,
+                                              size_t buffer_size);
+
+/**
+ * Abrir una sesion de streaming sobre un contexto
+ * Parametros y retorno iguales a voz_mobile_stream_begin. La sesion usa el
+ * scratch del contexto hasta finish/cancel, por lo que el contexto no debe
+ * usarse para otra operacion mientras la sesion este abierta.
+ */
+voz_mobile_stream* voz_ctx_stream_begin(voz_ctx* ctx,
+                                        const char* identificador,
+                                        int id_frase,
+                                        int operacion,
+                                        int sample_rate,
+                                        int channels);
+
+/**
+ * Obtener ultimo error ocurrido en un contexto
+ * @param ctx Contexto
+ * @param buffer Buffer donde se copiara el mensaje de error
+ * @param buffer_size Tamaño del buffer
+ */
+void voz_ctx_obtener_ultimo_error(const voz_ctx* ctx, char* buffer, size_t buffer_size);
+
 // ============================================================================
 // SINCRONIZACION
 // ============================================================================
 
 /**
  * Push: enviar vectores pendientes al servidor
+ * La cola se recorre por paginas (cursor id_sync, ver voz_mobile_configurar_sync):
+ * mientras se sube la pagina N se lee la N+1, y cada pagina aceptada por el
+ * servidor se confirma en una sola transaccion; si el servidor rechaza
+ * filas, solo se confirman las aceptadas y las rechazadas quedan pendientes
+ * para el siguiente push ("filas_rechazadas"). La memoria pico es la de dos
+ * paginas, sin importar cuantas filas haya pendientes. Si se interrumpe, el
+ * siguiente push continua desde la primera fila no confirmada; un error al
+ * leer una pagina de la cola tambien interrumpe el push y retorna -1.
+ * Antes de leer la primera pagina se compacta la cola: las operaciones
+ * sobre una misma entidad se colapsan en una operacion neta. Si la
+ * compactacion falla, el push sigue con la cola sin compactar.
+ * El JSON incluye "paginas", "filas_enviadas", "filas_confirmadas",
+ * "filas_rechazadas" y "filas_compactadas" (filas eliminadas por la compactacion).
  * @param server_url URL del servidor (ej: "http://localhost:8080")
  * @param resultado_json Buffer donde se copiara el resultado JSON
  * @param buffer_size Tamaño del buffer
  * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
  */
 int voz_mobile_sync_push(const char* server_url, char* resultado_json, size_t buffer_size);
 
+/**
+ * Configurar el tamaño de pagina de voz_mobile_sync_push
+ * @param tamano_pagina Filas por pagina (0 = por defecto, 500)
+ * @return 0 si exito, -1 si valor invalido
+ */
+int voz_mobile_configurar_sync(int tamano_pagina);
+
 /**
  * Pull: descargar cambios del servidor (frases, estados)
  * @param server_url URL del servidor
@@ -183,6 +1164,7 @@ int voz_mobile_sync_push(const char* server_url, char* resultado_json, size_t bu
  * @param resultado_json Buffer donde se copiara el resultado JSON
  * @param buffer_size Tamaño del buffer
  * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
  */
 int voz_mobile_sync_pull(const char* server_url, const char* desde, char* resultado_json, size_t buffer_size);
 
@@ -193,6 +1175,7 @@ int voz_mobile_sync_pull(const char* server_url, const char* desde, char* result
  * @param resultado_json Buffer donde se copiara el resultado JSON
  * @param buffer_size Tamaño del buffer
  * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
  */
 int voz_mobile_sync_modelo(const char* server_url, const char* identificador, char* resultado_json, size_t buffer_size);
 
@@ -200,7 +1183,7 @@ int voz_mobile_sync_modelo(const char* server_url, const char* identificador, ch
  * Obtener UUID del dispositivo
  * @param buffer Buffer donde se copiara el UUID
  * @param buffer_size Tamaño del buffer
- * @return 0 si exito, -1 si error
+ * @return 0 si exito, -1 si error, VOZ_ERROR_BUFFER_PEQUENO si el buffer no alcanza
  */
 int voz_mobile_obtener_uuid_dispositivo(char* buffer, size_t buffer_size);
 
@@ -211,25 +1194,233 @@ int voz_mobile_obtener_uuid_dispositivo(char* buffer, size_t buffer_size);
  */
 int voz_mobile_establecer_uuid_dispositivo(const char* uuid);
 
+// ============================================================================
+// TRABAJOS ASINCRONOS
+// ============================================================================
+//
+// Las operaciones pesadas (registro batch, reentrenamiento, sincronizacion)
+// pueden encolarse en los hilos internos de la libreria en lugar de bloquear
+// el hilo que llama por FFI. Cada submit devuelve un job id; el resultado se
+// consulta con poll/wait o se notifica al terminar por callback C y/o por un
+// SendPort de Dart (requiere voz_mobile_job_init_dart_api).
+// La cola atiende primero la prioridad mas alta; voz_mobile_autenticar no
+// pasa por la cola y nunca espera detras de un trabajo de fondo.
+// Todo trabajo retiene su resultado hasta que se libera con
+// voz_mobile_job_obtener_resultado o voz_mobile_job_liberar, tambien los
+// notificados por callback o SendPort.
+
+/** Prioridades de trabajo */
+#define VOZ_JOB_PRIORIDAD_ALTA      0
+#define VOZ_JOB_PRIORIDAD_NORMAL    1
+#define VOZ_JOB_PRIORIDAD_FONDO     2
+
+/** Estados de trabajo */
+#define VOZ_JOB_PENDIENTE   0
+#define VOZ_JOB_EN_CURSO    1
+#define VOZ_JOB_COMPLETADO  2
+#define VOZ_JOB_FALLIDO     3
+#define VOZ_JOB_CANCELADO   4
+
+/** Retorno de voz_mobile_job_obtener_resultado si el trabajo no ha terminado */
+#define VOZ_JOB_NO_TERMINADO -3
+
+/**
+ * Callback de fin de trabajo (se invoca desde un hilo interno)
+ * @param job_id ID del trabajo
+ * @param estado VOZ_JOB_COMPLETADO, VOZ_JOB_FALLIDO o VOZ_JOB_CANCELADO
+ * @param resultado_json Resultado JSON de la operacion (valido solo durante el callback)
+ * @param user_data Puntero entregado en el submit
+ */
+typedef void (*voz_mobile_job_callback)(int64_t job_id,
+                                        int estado,
+                                        const char* resultado_json,
+                                        void* user_data);
+
+/**
+ * Inicializar la API DL de Dart para poder notificar a un SendPort
+ * @param dart_api_data NativeApi.initializeApiDLData desde Dart
+ * @return 0 si exito, -1 si error
+ */
+int voz_mobile_job_init_dart_api(void* dart_api_data);
+
+/**
+ * Encolar voz_mobile_registrar_biometria_batch
+ * Las rutas se copian en el submit; el llamador puede liberarlas al volver.
+ * @param identificador Cedula del usuario
+ * @param audio_paths Array de rutas a archivos WAV
+ * @param num_audios Cantidad de audios en el array
+ * @param prioridad VOZ_JOB_PRIORIDAD_*
+ * @param callback Callback de fin (NULL = ninguno)
+ * @param user_data Puntero entregado al callback
+ * @param dart_port SendPort nativo de Dart a notificar con [job_id, estado] (0 = ninguno)
+ * @return ID del trabajo, -1 si error
+ */
+int64_t voz_mobile_job_registrar_biometria_batch(const char* identificador,
+                                                 const char** audio_paths,
+                                                 int num_audios,
+                                                 int prioridad,
+                                                 voz_mobile_job_callback callback,
+                                                 void* user_data,
+                                                 int64_t dart_port);
+
+/**
+ * Encolar voz_mobile_reentrenar_modelo
+ * @return ID del trabajo, -1 si error
+ */
+int64_t voz_mobile_job_reentrenar_modelo(int prioridad,
+                                         voz_mobile_job_callback callback,
+                                         void* user_data,
+                                         int64_t dart_port);
+
+/**
+ * Encolar voz_mobile_sync_push
+ * @return ID del trabajo, -1 si error
+ */
+int64_t voz_mobile_job_sync_push(const char* server_url,
+                                 int prioridad,
+                                 voz_mobile_job_callback callback,
+                                 void* user_data,
+                                 int64_t dart_port);
+
+/**
+ * Encolar voz_mobile_sync_modelo
+ * @return ID del trabajo, -1 si error
+ */
+int64_t voz_mobile_job_sync_modelo(const char* server_url,
+                                   const char* identificador,
+                                   int prioridad,
+                                   voz_mobile_job_callback callback,
+                                   void* user_data,
+                                   int64_t dart_port);
+
+/**
+ * Consultar el estado de un trabajo sin bloquear
+ * @param job_id ID del trabajo
+ * @return VOZ_JOB_*, -1 si el trabajo no existe
+ */
+int voz_mobile_job_estado(int64_t job_id);
+
+/**
+ * Esperar a que un trabajo termine
+ * @param job_id ID del trabajo
+ * @param timeout_ms Tiempo maximo de espera (< 0 = sin limite)
+ * @return VOZ_JOB_* al volver, -1 si el trabajo no existe
+ */
+int voz_mobile_job_esperar(int64_t job_id, int timeout_ms);
+
+/**
+ * Cancelar un trabajo
+ * Un trabajo pendiente se descarta; uno en curso se detiene en el siguiente
+ * punto seguro (entre audios, clases o lotes de sincronizacion).
+ * @param job_id ID del trabajo
+ * @return 0 si se solicito la cancelacion, -1 si el trabajo no existe o ya termino
+ */
+int voz_mobile_job_cancelar(int64_t job_id);
+
+/**
+ * Obtener el resultado de un trabajo terminado y liberarlo
+ * Si el trabajo no ha terminado o el buffer no alcanza, no se libera y se
+ * puede volver a consultar.
+ * @param job_id ID del trabajo
+ * @param retorno_operacion Recibe el valor de retorno de la operacion (ej: 0/-1)
+ * @param resultado_json Buffer donde se copiara el resultado JSON
+ * @param buffer_size Tamaño del buffer
+ * @return 0 si exito, VOZ_JOB_NO_TERMINADO si aun no termino, -1 si el trabajo no existe,
+ *         VOZ_ERROR_BUFFER_PEQUENO si el buffer no alcanza
+ */
+int voz_mobile_job_obtener_resultado(int64_t job_id,
+                                     int* retorno_operacion,
+                                     char* resultado_json,
+                                     size_t buffer_size);
+
+/**
+ * Liberar un trabajo sin leer su resultado
+ * Un trabajo pendiente o en curso se cancela y se libera al terminar; el
+ * callback y el SendPort se siguen notificando. El job_id deja de ser valido.
+ * @param job_id ID del trabajo
+ * @return 0 si exito, -1 si el trabajo no existe
+ */
+int voz_mobile_job_liberar(int64_t job_id);
+
 // ============================================================================
 // UTILIDADES
 // ============================================================================
 
 /**
- * Obtener ultimo error ocurrido
+ * Obtener ultimo error ocurrido en el hilo que llama (thread-local)
+ * Un isolate de Dart puede pasar de un hilo a otro entre dos llamadas FFI;
+ * si el error debe leerse despues, usar un voz_ctx y
+ * voz_ctx_obtener_ultimo_error.
  * @param buffer Buffer donde se copiara el mensaje de error
  * @param buffer_size Tamaño del buffer
  */
 void voz_mobile_obtener_ultimo_error(char* buffer, size_t buffer_size);
 
 /**
- * Obtener estadisticas del modelo
+ * Obtener estadisticas del modelo y latencias por etapa
+ * Ademas de las estadisticas del modelo incluye "latencias": por cada etapa
+ * ("decodificacion", "vad", "mfcc", "puntuacion", "db_escritura", "sync")
+ * {"conteo", "p50_ms", "p95_ms", "p99_ms", "max_ms"}.
+ * Las latencias se registran siempre con contadores por hilo sin locks en
+ * histogramas de buckets logaritmicos; los percentiles son aproximados al
+ * bucket (error relativo < 10%).
  * @param stats_json Buffer donde se copiara el JSON con estadisticas
  * @param buffer_size Tamaño del buffer
- * @return 0 si exito, -1 si error
+ * @return 0 si exito, -1 si error, VOZ_ERROR_BUFFER_PEQUENO si el buffer no alcanza
  */
 int voz_mobile_obtener_estadisticas(char* stats_json, size_t buffer_size);
 
+/**
+ * Reiniciar los histogramas de latencia (no afecta al modelo)
+ */
+void voz_mobile_reiniciar_estadisticas();
+
+/**
+ * Habilitar el trazado de spans (formato Chrome trace / Perfetto)
+ * Registra spans de init, autenticacion, registro, entrenamiento, sync y
+ * consultas de SQLiteAdapter (categoria "sqlite") en un buffer circular sin
+ * locks; al llenarse se sobrescriben los mas antiguos. Cada span se escribe
+ * una sola vez, al cerrarse, como evento completo ("ph": "X" con "ts",
+ * "dur" e id de hilo), por lo que el buffer nunca guarda un fin sin su
+ * inicio y el wrap solo descarta spans enteros.
+ * Deshabilitado, cada span cuesta una lectura atomica.
+ * @param capacidad_eventos Tamaño del buffer circular (0 = por defecto, 65536)
+ * @return 0 si exito, -1 si error
+ */
+int voz_mobile_traza_habilitar(size_t capacidad_eventos);
+
+/**
+ * Deshabilitar el trazado (los eventos ya registrados se conservan)
+ */
+void voz_mobile_traza_deshabilitar();
+
+/**
+ * Exportar los eventos registrados como JSON de Chrome trace
+ * El archivo se abre en chrome://tracing o ui.perfetto.dev.
+ * @param ruta_json Ruta del archivo a escribir
+ * @param limpiar Si es 1, vacia el buffer despues de exportar
+ * @return Cantidad de eventos exportados, -1 si error
+ */
+int voz_mobile_traza_exportar(const char* ruta_json, int limpiar);
+
+/**
+ * Copiar un resultado JSON truncado por su id
+ * Sirve para toda la libreria (funciones globales, voz_ctx_* y sync): el id
+ * viene en "id_resultado" del JSON truncado (ver CODIGOS DE RETORNO). El
+ * resultado se descarta tras copiarlo con exito; la libreria conserva los
+ * ultimos 32 sin reclamar y descarta los mas antiguos.
+ * @param id_resultado Id recibido en el JSON truncado
+ * @param resultado_json Buffer destino (NULL = solo consultar el tamaño)
+ * @param buffer_size Tamaño del buffer
+ * @param tamano_requerido Si no es NULL, recibe los bytes necesarios incluyendo el '\0'
+ * @return 0 si exito, VOZ_ERROR_BUFFER_PEQUENO si no cabe, -1 si el id no
+ *         existe o ya fue copiado o descartado
+ */
+int voz_mobile_copiar_resultado(int64_t id_resultado,
+                                char* resultado_json,
+                                size_t buffer_size,
+                                size_t* tamano_requerido);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,7 +1,19 @@
 #ifndef SQLITE_ADAPTER_H
 #define SQLITE_ADAPTER_H
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 #include <optional>
 
@@ -44,6 +56,45 @@ struct ValidacionBiometrica {
     std::string fecha_validacion;
 };
 
+// ----------------------------------------------------------------------------
+// Formato de la columna vector_features (esquema v2)
+// ----------------------------------------------------------------------------
+// [CabeceraBlobFeatures][float32 little-endian x dimension]
+// Versiones anteriores guardaban doubles sin cabecera; migrarFeaturesAFloat32()
+// convierte las filas existentes.
+
+constexpr uint16_t FEATURES_BLOB_VERSION = 1;
+constexpr int ESQUEMA_VERSION_FEATURES_F32 = 2;   // PRAGMA user_version
+
+struct CabeceraBlobFeatures {
+    uint16_t version;       // FEATURES_BLOB_VERSION
+    uint16_t reservado;     // 0
+    uint32_t dimension;     // Cantidad de floats que siguen
+};
+static_assert(sizeof(CabeceraBlobFeatures) == 8, "CabeceraBlobFeatures debe ocupar 8 bytes");
+
+// Vista de solo lectura sobre los floats de una fila. No copia: apunta al
+// buffer que entrega sqlite3_column_blob y solo es valida dentro del
+// callback que la recibe. sqlite no garantiza que ese buffer este alineado
+// a 4 bytes, por lo que los floats se leen con memcpy y nunca a traves de
+// un const float* (los destinos soportados son little-endian).
+struct VistaFeatures {
+    int id_caracteristica;
+    int id_usuario;
+    int id_credencial;
+    const unsigned char* bytes;     // Floats que siguen a la cabecera
+    size_t dimension;
+
+    float operator[](size_t i) const {
+        float valor;
+        std::memcpy(&valor, bytes + i * sizeof(float), sizeof(float));
+        return valor;
+    }
+    size_t size() const { return dimension; }
+    // Copia los dimension floats a un buffer alineado del llamador
+    void copiarA(float* destino) const { std::memcpy(destino, bytes, dimension * sizeof(float)); }
+};
+
 struct CaracteristicaHablante {
     int id_caracteristica;
     int id_usuario;
@@ -68,31 +119,305 @@ struct CaracteristicaOreja {
     int sincronizado;
 };
 
+// ============================================================================
+// Consultas preparadas
+// ============================================================================
+
+// Identificador de cada consulta fija del adaptador. Cada una se prepara una
+// sola vez por conexion y se reutiliza desde el cache de sentencias.
+enum class ConsultaId {
+    UsuarioPorIdentificador,
+    UsuarioPorId,
+    InsertarUsuario,
+    ActualizarEstadoUsuario,
+    ListarUsuarios,
+    CredencialPorUsuario,
+    InsertarCredencial,
+    ActualizarEstadoCredencial,
+    ListarCredencialesPorUsuario,
+    FrasesActivas,
+    FrasePorId,
+    InsertarFrase,
+    DesactivarFrase,
+    InsertarValidacion,
+    ListarValidacionesPorCredencial,
+    InsertarColaSincronizacion,
+    ObtenerColaSincronizacion,
+    ObtenerPaginaSincronizacion,
+    MarcarSincronizado,
+    MarcarRangoSincronizado,
+    EliminarDeColaSincronizacion,
+    ContarPendientes,
+    GuardarConfigSync,
+    ObtenerConfigSync,
+    InsertarCaracteristica,
+    CaracteristicasPendientes,
+    MarcarCaracteristicaSincronizada,
+    CaracteristicasPorUsuario,
+    InsertarCaracteristicaOreja,
+    CaracteristicasOrejaPendientes,
+    MarcarCaracteristicaOrejaSincronizada,
+    CaracteristicasOrejaPorUsuario,
+    Total   // Cantidad de consultas, no es una consulta
+};
+
+// Resultado de avanzar una sentencia con siguienteFila()
+enum class ResultadoPaso {
+    Fila,   // SQLITE_ROW
+    Fin,    // SQLITE_DONE
+    Error   // Cualquier otro codigo (ver SentenciaPreparada::codigo)
+};
+
+// Sentencia tomada del cache. Al destruirse hace sqlite3_reset y
+// sqlite3_clear_bindings para dejarla lista para la siguiente llamada.
+// Los indices de bind empiezan en 1 y los de columna en 0, como en sqlite3.
+class SentenciaPreparada {
+private:
+    sqlite3_stmt* stmt;
+    int ultimoCodigo = SQLITE_OK;
+
+public:
+    explicit SentenciaPreparada(sqlite3_stmt* s) : stmt(s) {}
+    ~SentenciaPreparada() {
+        if (stmt) {
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+        }
+    }
+    SentenciaPreparada(const SentenciaPreparada&) = delete;
+    SentenciaPreparada& operator=(const SentenciaPreparada&) = delete;
+    SentenciaPreparada(SentenciaPreparada&& otra) noexcept
+        : stmt(otra.stmt), ultimoCodigo(otra.ultimoCodigo) { otra.stmt = nullptr; }
+
+    bool valida() const { return stmt != nullptr; }
+
+    // Acepta cualquier tipo entero (int, int64_t, uint32_t, size_t, bool...).
+    // Los que caben en int van por sqlite3_bind_int y el resto por
+    // sqlite3_bind_int64; un sin signo mayor que INT64_MAX se rechaza.
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    bool bind(int indice, T valor) {
+        if constexpr (sizeof(T) < sizeof(int) || (std::is_signed<T>::value && sizeof(T) == sizeof(int))) {
+            return sqlite3_bind_int(stmt, indice, static_cast<int>(valor)) == SQLITE_OK;
+        } else {
+            if constexpr (std::is_unsigned<T>::value && sizeof(T) >= sizeof(sqlite3_int64)) {
+                if (valor > static_cast<T>(INT64_MAX)) {
+                    return false;
+                }
+            }
+            return sqlite3_bind_int64(stmt, indice, static_cast<sqlite3_int64>(valor)) == SQLITE_OK;
+        }
+    }
+    bool bind(int indice, double valor) { return sqlite3_bind_double(stmt, indice, valor) == SQLITE_OK; }
+    bool bind(int indice, const std::string& valor) {
+        return sqlite3_bind_text(stmt, indice, valor.c_str(), static_cast<int>(valor.size()),
+                                 SQLITE_TRANSIENT) == SQLITE_OK;
+    }
+    bool bindBlob(int indice, const void* datos, int bytes) {
+        return sqlite3_bind_blob(stmt, indice, datos, bytes, SQLITE_TRANSIENT) == SQLITE_OK;
+    }
+    bool bindNulo(int indice) { return sqlite3_bind_null(stmt, indice) == SQLITE_OK; }
+
+    // Los bucles de lectura deben distinguir Fin de Error: una lectura que
+    // falla (SQLITE_BUSY, SQLITE_CORRUPT...) no es un resultado vacio
+    ResultadoPaso siguienteFila() {
+        ultimoCodigo = sqlite3_step(stmt);
+        if (ultimoCodigo == SQLITE_ROW) {
+            return ResultadoPaso::Fila;
+        }
+        return ultimoCodigo == SQLITE_DONE ? ResultadoPaso::Fin : ResultadoPaso::Error;
+    }
+    // Para INSERT/UPDATE/DELETE: true si termino sin error
+    bool ejecutar() {
+        ultimoCodigo = sqlite3_step(stmt);
+        return ultimoCodigo == SQLITE_DONE || ultimoCodigo == SQLITE_ROW;
+    }
+    // Codigo de sqlite3_step de la ultima llamada a siguienteFila/ejecutar
+    int codigo() const { return ultimoCodigo; }
+
+    int columnaInt(int columna) const { return sqlite3_column_int(stmt, columna); }
+    int64_t columnaInt64(int columna) const { return sqlite3_column_int64(stmt, columna); }
+    double columnaDouble(int columna) const { return sqlite3_column_double(stmt, columna); }
+    std::string columnaTexto(int columna) const {
+        const unsigned char* texto = sqlite3_column_text(stmt, columna);
+        return texto ? std::string(reinterpret_cast<const char*>(texto),
+                                   sqlite3_column_bytes(stmt, columna))
+                     : std::string();
+    }
+    const void* columnaBlob(int columna) const { return sqlite3_column_blob(stmt, columna); }
+    int columnaBytes(int columna) const { return sqlite3_column_bytes(stmt, columna); }
+    bool columnaEsNula(int columna) const { return sqlite3_column_type(stmt, columna) == SQLITE_NULL; }
+};
+
+// Contadores del cache de sentencias (para comparar costo por consulta)
+struct EstadisticasSentencias {
+    uint64_t preparaciones;     // sqlite3_prepare_v2 ejecutados
+    uint64_t reutilizaciones;   // Usos servidos desde el cache
+};
+
+// Pagina de la cola de sincronizacion leida por cursor (id_sync)
+struct PaginaSincronizacion {
+    bool ok;                // false si la lectura fallo; filas viene vacio y no es la ultima pagina
+    json filas;             // Array de filas con id_sync > cursor, ordenadas por id_sync
+    int ultimoIdSync;       // Cursor para pedir la siguiente pagina
+    bool hayMas;            // false si esta es la ultima pagina
+};
+
+// Resultado de compactar la cola de sincronizacion
+struct ResultadoCompactacion {
+    bool ok;                // false si fallo (se hizo rollback y la cola no cambio)
+    int filasAntes;
+    int filasEliminadas;    // Filas absorbidas por otra operacion o anuladas
+};
+
+// Conexion con su propio cache de sentencias indexado por ConsultaId
+// (una sentencia preparada pertenece a una sola conexion)
+struct ConexionSQLite {
+    sqlite3* db = nullptr;
+    std::array<sqlite3_stmt*, static_cast<size_t>(ConsultaId::Total)> sentencias{};
+};
+
 // ============================================================================
 // Adaptador SQLite para App Movil
 // ============================================================================
+//
+// La base se abre en modo WAL. Todas las escrituras pasan por un unico hilo
+// escritor que agrupa las tareas encoladas en una transaccion (group commit,
+// un SAVEPOINT por tarea para que una falla no arrastre a las demas). Las
+// lecturas usan un pool de conexiones de solo lectura, por lo que una
+// autenticacion no espera detras de un sync o un registro en curso.
+// Los metodos publicos de escritura encolan su tarea y esperan el commit de
+// su lote, conservando su firma sincrona.
+// Las validaciones de una autenticacion van por un carril prioritario: el
+// escritor vacia ese anillo antes de tomar tareas de la cola comun, asi un
+// login no espera detras de un lote de acks de sync o de una compactacion.
+// El hilo escritor es por instancia: dos adaptadores sobre el mismo archivo
+// volverian a competir por el lock de escritura de SQLite. Por eso los
+// contextos (voz_ctx) obtienen el adaptador con compartido(), que entrega
+// una sola instancia por ruta y la destruye al soltar la ultima referencia.
 
 class SQLiteAdapter {
 private:
-    sqlite3* db;
+    ConexionSQLite escritura;           // Solo la usa hiloEscritor
     std::string dbPath;
     bool conectado;
 
+    // Pool de conexiones de solo lectura
+    std::vector<std::unique_ptr<ConexionSQLite>> lectores;
+    std::vector<ConexionSQLite*> lectoresLibres;
+    std::mutex mutexLectores;
+    std::condition_variable lectorDisponible;
+    int numLectores;
+
+    // Hilo escritor con group commit
+    struct TareaEscritura {
+        std::function<bool(ConexionSQLite&)> tarea;
+        std::promise<bool> resultado;
+    };
+    std::deque<TareaEscritura> colaEscrituras;
+    // Carril prioritario: anillo de tamaño fijo, sin std::function, promise
+    // ni json por escritura (la fila de sync_queue se arma con snprintf)
+    struct ValidacionPendiente {
+        int idCredencial;
+        double confianza;
+        char resultado[16];
+    };
+    static constexpr size_t CAPACIDAD_INTERACTIVAS = 64;
+    std::array<ValidacionPendiente, CAPACIDAD_INTERACTIVAS> anilloInteractivas{};
+    size_t inicioInteractivas = 0;      // Protegidos por mutexEscrituras
+    size_t cantidadInteractivas = 0;
+    bool compactacionPendiente = false;
+    std::mutex mutexEscrituras;
+    std::condition_variable hayEscrituras;
+    std::thread hiloEscritor;
+    bool detenerEscritor;
+    void bucleEscritor();
+
+    std::atomic<uint64_t> preparaciones{0};
+    std::atomic<uint64_t> reutilizaciones{0};
+
+    static const char* sqlConsulta(ConsultaId id);
+    SentenciaPreparada preparar(ConexionSQLite& conexion, ConsultaId id);
+    void finalizarSentencias(ConexionSQLite& conexion);
+
+    // Conexion del pool prestada; se devuelve al destruirse, tambien si la
+    // consulta sale por excepcion o por un return temprano
+    class LectorPrestado {
+    private:
+        SQLiteAdapter* adaptador;
+        ConexionSQLite* conexion;
+
+    public:
+        LectorPrestado(SQLiteAdapter& a, ConexionSQLite& c) : adaptador(&a), conexion(&c) {}
+        ~LectorPrestado() {
+            if (conexion) {
+                adaptador->devolverLector(*conexion);
+            }
+        }
+        LectorPrestado(const LectorPrestado&) = delete;
+        LectorPrestado& operator=(const LectorPrestado&) = delete;
+        LectorPrestado(LectorPrestado&& otro) noexcept
+            : adaptador(otro.adaptador), conexion(otro.conexion) { otro.conexion = nullptr; }
+
+        ConexionSQLite& operator*() const { return *conexion; }
+        ConexionSQLite* operator->() const { return conexion; }
+    };
+
+    // Bloquea hasta que haya una conexion libre
+    LectorPrestado tomarLector();
+    void devolverLector(ConexionSQLite& conexion);
+
     void verificarConexion();
     void registrarEnColaSincronizacion(const std::string& tabla, 
                                        const std::string& accion,
                                        const json& datos);
 
+    // Compactacion sobre una conexion de escritura ya tomada. La usan
+    // compactarColaSincronizacion (como tarea encolada) y el hilo escritor
+    // para la compactacion automatica, que corre en su propia transaccion
+    // solo cuando el anillo prioritario y la cola comun estan vacios.
+    ResultadoCompactacion compactar(ConexionSQLite& conexion);
+    // Histeresis de la compactacion automatica (solo las toca el hilo escritor)
+    int filasDesdeCompactacion = 0;
+    int pendientesTrasCompactacion = 0;
+    // Pushes en curso (solo lo toca el hilo escritor). finalizarPush encola
+    // el decremento como tarea y, si queda en 0 con una compactacion
+    // automatica pendiente, la deja lista para el escritor.
+    int pushesActivos = 0;
+    void finalizarPush();
+
 public:
-    SQLiteAdapter(const std::string& path);
+    static constexpr int LECTORES_POR_DEFECTO = 2;
+    static constexpr size_t MAX_TAREAS_POR_LOTE = 64;
+
+    explicit SQLiteAdapter(const std::string& path, int conexionesLectura = LECTORES_POR_DEFECTO);
     ~SQLiteAdapter();
+    SQLiteAdapter(const SQLiteAdapter&) = delete;
+    SQLiteAdapter& operator=(const SQLiteAdapter&) = delete;
+
+    // Adaptador unico por ruta para todo el proceso; conexionesLectura solo
+    // aplica al crearlo. nullptr si no se pudo abrir la base. La ruta se
+    // normaliza con realpath del directorio padre mas el nombre del archivo,
+    // porque en el primer arranque la base todavia no existe.
+    static std::shared_ptr<SQLiteAdapter> compartido(const std::string& path,
+                                                     int conexionesLectura = LECTORES_POR_DEFECTO);
 
     // Inicializacion
     bool inicializarEsquema();
+    // Convierte vector_features de doubles sin cabecera a float32 con cabecera
+    // en una sola transaccion y sube PRAGMA user_version a ESQUEMA_VERSION_FEATURES_F32.
+    // Retorna la cantidad de filas convertidas, -1 si error (se hace rollback).
+    int migrarFeaturesAFloat32();
+    int obtenerVersionEsquema();
     bool conectar();
     void desconectar();
     bool estaConectado() const { return conectado; }
 
+    // Encolar una escritura para el hilo escritor; el futuro se resuelve al
+    // hacer commit del lote que la contiene (false si la tarea o el commit fallan)
+    std::future<bool> encolarEscritura(std::function<bool(ConexionSQLite&)> tarea);
+    // Esperar a que se hayan confirmado todas las escrituras encoladas hasta ahora
+    bool esperarEscrituras();
+
     // ========================================================================
     // USUARIOS
     // ========================================================================
@@ -126,6 +451,10 @@ public:
     // ========================================================================
     int insertarValidacion(int idCredencial, const std::string& resultado, 
                           double confianza);
+    // Version de autenticacion: copia la validacion al carril prioritario y
+    // retorna sin esperar el commit (no hay id). false si el anillo esta
+    // lleno o resultado no cabe; en ese caso usar insertarValidacion.
+    bool encolarValidacion(int idCredencial, const char* resultado, double confianza);
     std::vector<ValidacionBiometrica> listarValidacionesPorCredencial(int idCredencial);
 
     // ========================================================================
@@ -133,6 +462,80 @@ public:
     // ========================================================================
     json obtenerColaSincronizacion();
     bool marcarComoSincronizado(int idSync);
+
+    static constexpr int TAMANO_PAGINA_SYNC = 500;
+    // Lee como maximo tamanoPagina filas con id_sync > desdeIdSync; memoria acotada
+    // por pagina sin importar el tamaño total de la cola. Con ok == false
+    // el push se aborta: una pagina vacia no debe tomarse como fin de cola
+    PaginaSincronizacion obtenerPaginaSincronizacion(int desdeIdSync,
+                                                     int tamanoPagina = TAMANO_PAGINA_SYNC);
+    // Confirman varias filas en una sola transaccion; retornan las filas marcadas, -1 si error
+    int marcarComoSincronizados(const std::vector<int>& idsSync);
+    // Marca las filas con desdeIdSync < id_sync <= hastaIdSync, es decir, una
+    // pagina completa: desde = cursor con el que se pidio, hasta = ultimoIdSync.
+    // Solo si el servidor acepto todas las filas de la pagina; si rechazo
+    // alguna, usar marcarComoSincronizados con los id_sync aceptados para que
+    // las rechazadas sigan pendientes y se reintenten en el siguiente push.
+    int marcarRangoSincronizado(int desdeIdSync, int hastaIdSync);
+
+    // Colapsa las operaciones pendientes sobre una misma (tabla, clave primaria)
+    // en una operacion neta, en una sola transaccion. La clave se toma de datos
+    // segun la tabla:
+    //   usuarios                      -> id_usuario
+    //   credenciales_biometricas      -> id_credencial
+    //   frases_dinamicas              -> id_frase
+    //   validaciones_biometricas      -> id_validacion
+    //   caracteristicas (voz y oreja) -> id_caracteristica
+    // Las filas de otras tablas o cuyo datos no trae la clave no se compactan.
+    // Reglas por clave:
+    //   insert + update*     -> insert con los datos finales (en la posicion del insert)
+    //   update + update*     -> update con los datos finales (en la posicion del ultimo)
+    //   update* + delete     -> delete (en la posicion del delete)
+    //   insert + ... + delete -> nada, salvo que otra fila pendiente dependa de esa clave
+    // El orden por id_sync entre tablas dependientes (usuario -> credencial ->
+    // caracteristica) se conserva: un insert nunca pasa despues de los inserts
+    // que lo referencian y un delete nunca antes de las operaciones de sus dependientes.
+    // Mientras haya un push en curso no se compacta: las filas leidas pueden
+    // estar en vuelo y su confirmacion debe seguir correspondiendo a la fila
+    // que se envio. compactarColaSincronizacion retorna ok con 0 eliminadas.
+    //
+    // registrarEnColaSincronizacion pide una compactacion automatica cuando hay
+    // mas de UMBRAL_COMPACTACION pendientes y, desde la ultima compactacion, se
+    // agregaron al menos max(INTERVALO_COMPACTACION, pendientes que quedaron / 2)
+    // filas; asi una cola que no se reduce no se recorre en cada insercion y el
+    // costo amortizado por fila es constante. La compactacion no corre dentro
+    // del lote que la pidio sino despues, con prioridad minima, y si hay un
+    // push en curso queda pendiente hasta que termine el ultimo.
+    static constexpr int UMBRAL_COMPACTACION = 1000;
+    static constexpr int INTERVALO_COMPACTACION = 250;
+    ResultadoCompactacion compactarColaSincronizacion();
+
+    // Marca de un push en curso; la retira al destruirse, tambien si el push
+    // falla. Cada push tiene la suya (contador), asi terminar uno no quita la
+    // proteccion de otro que siga leyendo.
+    class PushEnCurso {
+    private:
+        SQLiteAdapter* adaptador;
+
+    public:
+        explicit PushEnCurso(SQLiteAdapter* a) : adaptador(a) {}
+        ~PushEnCurso() {
+            if (adaptador) {
+                adaptador->finalizarPush();
+            }
+        }
+        PushEnCurso(const PushEnCurso&) = delete;
+        PushEnCurso& operator=(const PushEnCurso&) = delete;
+        PushEnCurso(PushEnCurso&& otro) noexcept : adaptador(otro.adaptador) { otro.adaptador = nullptr; }
+
+        // false si no se pudo publicar la marca; el push no debe leer la cola
+        bool activa() const { return adaptador != nullptr; }
+    };
+    // Se llama despues de compactar y antes de leer la primera pagina. Corre
+    // como tarea del hilo escritor y espera su commit: una compactacion
+    // anterior ya es visible para la lectura y una posterior ve la marca.
+    PushEnCurso iniciarPush();
+
     int contarPendientesSincronizacion();
 
     // ========================================================================
@@ -151,6 +554,13 @@ public:
     bool marcarCaracteristicaSincronizada(int idCaracteristica);
     std::vector<CaracteristicaHablante> obtenerCaracteristicasPorUsuario(int idUsuario);
 
+    int insertarCaracteristicaLocal(int idUsuario, int idCredencial,
+                                    const float* features, size_t dimension,
+                                    const std::string& uuidDispositivo = "");
+    // Recorre las filas del usuario sin copiar los vectores; retorna la cantidad de filas
+    int visitarCaracteristicasPorUsuario(int idUsuario,
+                                         const std::function<void(const VistaFeatures&)>& visitante);
+
     // ========================================================================
     // CARACTERISTICAS OREJA
     // ========================================================================
@@ -161,12 +571,23 @@ public:
     bool marcarCaracteristicaOrejaSincronizada(int idCaracteristica);
     std::vector<CaracteristicaOreja> obtenerCaracteristicasOrejaPorUsuario(int idUsuario);
 
+    int insertarCaracteristicaOrejaLocal(int idUsuario, int idCredencial,
+                                         const float* features, size_t dimension,
+                                         const std::string& uuidDispositivo = "");
+    int visitarCaracteristicasOrejaPorUsuario(int idUsuario,
+                                              const std::function<void(const VistaFeatures&)>& visitante);
+
     // ========================================================================
     // UTILIDADES
     // ========================================================================
+    // SQL ad-hoc: se prepara en cada llamada, no pasa por el cache de sentencias
     json ejecutarConsultaJSON(const std::string& sql);
     bool ejecutarComando(const std::string& sql);
     std::string obtenerUltimoError() const;
+    EstadisticasSentencias obtenerEstadisticasSentencias() const {
+        return EstadisticasSentencias{preparaciones.load(std::memory_order_relaxed),
+                                      reutilizaciones.load(std::memory_order_relaxed)};
+    }
 };
 
 #endif // SQLITE_ADAPTER_H
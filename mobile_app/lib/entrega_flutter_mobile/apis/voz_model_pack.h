@@ -0,0 +1,118 @@
+#ifndef VOZ_MODEL_PACK_H
+#define VOZ_MODEL_PACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// Formato empaquetado del modelo SVM de voz (modelo_voz.vzpk)
+// ============================================================================
+//
+// Reemplaza metadata.json + un class_<id>.bin por hablante con un solo
+// archivo que se carga con mmap. Todos los enteros y reales son
+// little-endian. Disposicion:
+//
+//   [voz_pack_header]                      96 bytes
+//   [int32  class_ids[num_classes]]        ordenados ascendente
+//   [padding hasta alignment]
+//   [T      weights[num_classes][row_stride]]  fila i = clase class_ids[i]
+//   [double bias[num_classes]]
+//   [double scales[num_classes]]           solo si weight_type == VOZ_PACK_INT8
+//   [voz_pack_norm norm[num_classes]]      solo si norm_offset != 0
+//   [double means[num_classes][dimension]] solo si means_offset != 0
+//   [double mean_counts[num_classes]]      idem, justo despues de means
+//
+// T depende de weight_type: double, float16 (IEEE 754 half) o int8 con una
+// escala por fila (w = scales[i] * q). row_stride es dimension redondeada
+// hacia arriba al multiplo de (alignment / sizeof(T)); las columnas de
+// relleno valen 0, por lo que cada fila empieza alineada y se puede recorrer
+// con SIMD sin copiar.
+// checksum es CRC-32 (IEEE) de todo el archivo, cabecera incluida, con el
+// campo checksum en cero al calcularlo. Ademas del checksum el loader
+// rechaza el archivo si alignment no es potencia de 2, si row_stride <
+// dimension, o si alguna seccion no cae dentro de [header_size, file_size)
+// en el orden de la disposicion anterior.
+// source_crc es CRC-32 de las fuentes de las que salio el paquete
+// (metadata.json seguido de cada class_<id>.bin en orden ascendente de id).
+// Solo lo usa pack_voice_models.py --verificar; la libreria no lo comprueba
+// al cargar, y los paquetes que escribe ella misma llevan 0.
+//
+// norm guarda, por clase, la media y desviacion de los scores de impostores
+// (muestras de entrenamiento de las demas clases) para Z-norm:
+// score_norm = (score - media) / desviacion, O(1) por autenticacion.
+// cantidad permite acumular impostores nuevos (Welford). Si los pesos de
+// una clase cambian online, su media se recalcula con means: exacta para
+// VOZ_PACK_FLOAT64 y VOZ_PACK_FLOAT16, donde el score es lineal, y
+// aproximada para VOZ_PACK_INT8, que cuantiza la entrada por request. La
+// desviacion queda aproximada hasta el siguiente reentrenamiento.
+//
+// means guarda el vector medio de entrenamiento de cada clase y
+// mean_counts cuantas muestras lo forman. El registro incremental los usa
+// como negativos de una clase nueva (una media por clase) y actualiza la
+// media de la clase registrada; con eso no necesita el dataset completo.
+//
+// Solo existe una version del formato: un archivo con otra version se
+// rechaza al cargar y el modelo se regenera.
+
+#define VOZ_PACK_MAGIC          "VZPK"
+#define VOZ_PACK_VERSION        2u
+#define VOZ_PACK_ALIGNMENT      64u
+#define VOZ_PACK_HEADER_SIZE    96u
+#define VOZ_PACK_FILENAME       "modelo_voz.vzpk"
+
+/** Tipos de peso */
+#define VOZ_PACK_FLOAT64        0u
+#define VOZ_PACK_FLOAT16        1u
+#define VOZ_PACK_INT8           2u
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct voz_pack_header {
+    char magic[4];              // "VZPK"
+    uint32_t version;           // VOZ_PACK_VERSION
+    uint32_t dimension;         // Dimension del vector de caracteristicas (250)
+    uint32_t num_classes;       // Cantidad de hablantes
+    uint32_t row_stride;        // Elementos por fila de weights (>= dimension)
+    uint32_t alignment;         // Alineacion en bytes de weights (VOZ_PACK_ALIGNMENT)
+    uint64_t class_ids_offset;  // Offset de class_ids desde el inicio del archivo
+    uint64_t weights_offset;    // Offset de weights (multiplo de alignment)
+    uint64_t bias_offset;       // Offset de bias
+    uint64_t file_size;         // Tamaño total esperado del archivo
+    uint32_t checksum;          // CRC-32 de [0, file_size) con este campo en cero
+    uint32_t model_version;     // Version del modelo (se incrementa en cada actualizacion)
+    uint32_t weight_type;       // VOZ_PACK_FLOAT64, VOZ_PACK_FLOAT16 o VOZ_PACK_INT8
+    uint32_t source_crc;        // CRC-32 de metadata.json + class_<id>.bin (0 = sin fuentes)
+    uint64_t scales_offset;     // Offset de scales (0 si weight_type != VOZ_PACK_INT8)
+    uint64_t norm_offset;       // Offset de norm (0 si no hay estadisticas de cohorte)
+    uint64_t means_offset;      // Offset de means (0 si el paquete no trae medias por clase)
+} voz_pack_header;
+
+/** Estadisticas de scores de impostores de una clase (Z-norm) */
+typedef struct voz_pack_norm {
+    double media;
+    double desviacion;
+    double cantidad;            // Muestras de impostores acumuladas
+} voz_pack_norm;
+
+/**
+ * Vista de solo lectura sobre un modelo empaquetado mapeado en memoria
+ * Los punteros apuntan dentro del mapeo; no se copian los pesos.
+ */
+typedef struct voz_pack_view {
+    const voz_pack_header* header;
+    const int32_t* class_ids;
+    const void* weights;        // double, uint16_t (half) o int8_t segun weight_type
+    const double* bias;
+    const double* scales;       // NULL salvo VOZ_PACK_INT8
+    const voz_pack_norm* norm;  // NULL si norm_offset == 0
+    const double* means;        // NULL si means_offset == 0; fila i = clase class_ids[i]
+    const double* mean_counts;  // NULL si means_offset == 0
+} voz_pack_view;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VOZ_MODEL_PACK_H
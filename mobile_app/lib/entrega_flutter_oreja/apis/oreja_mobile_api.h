@@ -13,12 +13,43 @@ extern "C"
 {
 #endif
 
+    // ============================================================================
+    // CODIGOS DE RETORNO
+    // ============================================================================
+    //
+    // Ninguna funcion trunca un resultado JSON. Si resultado_json no alcanza:
+    //  - oreja_mobile_evaluar y oreja_mobile_obtener_estadisticas retornan
+    //    OREJA_ERROR_BUFFER_PEQUENO, escriben '\0' en el primer byte (si
+    //    buffer_size > 0) y pueden repetirse con un buffer mayor.
+    //  - Registro, autenticacion y sync ya confirmaron su efecto: retornan su
+    //    codigo normal, nunca OREJA_ERROR_BUFFER_PEQUENO, para que el llamador
+    //    no los repita. El buffer recibe
+    //    {"truncado": true, "tamano_requerido": n, "id_resultado": k} y el
+    //    JSON completo se lee con oreja_mobile_copiar_resultado(k, ...). El id
+    //    es unico por llamada, asi que otro isolate no puede recibir ese
+    //    resultado. Estas operaciones exigen buffer_size >=
+    //    OREJA_BUFFER_MINIMO: con menos retornan -1 sin ejecutar nada.
+
+    /** Codigo de retorno cuando el buffer del llamador es insuficiente */
+#define OREJA_ERROR_BUFFER_PEQUENO -2
+
+    /** buffer_size minimo de las operaciones con efecto (cabe el JSON truncado) */
+#define OREJA_BUFFER_MINIMO 128
+
     // ============================================================================
     // GESTION DE LIBRERIA
     // ============================================================================
 
     /**
      * Inicializar la libreria biometrica de oreja
+     * Arranque en caliente: tras el primer init exitoso se escribe un snapshot
+     * binario (<model_dir>/oreja_snapshot.bin) con zscore_params, PCA, LDA,
+     * dataset y templates ya parseados, checksum por seccion y la huella
+     * (ruta, inodo, tamaño, mtime) de cada archivo fuente; el inodo detecta
+     * archivos reemplazados por rename con igual tamaño y mtime. Los init
+     * siguientes lo mapean con mmap si la huella coincide; si algun archivo cambio, se
+     * parsean las fuentes y el snapshot se regenera. oreja_mobile_registrar_biometria
+     * y oreja_mobile_reload_templates tambien lo regeneran.
      * @param model_dir Directorio con modelos (zscore_params.dat, modelo_pca.dat, modelo_lda.dat)
      * @param dataset_csv Ruta CSV con dataset LDA (ej: out/caracteristicas_lda_train.csv)
      * @param templates_csv Ruta CSV de templates (ej: out/templates_k1.csv)
@@ -39,12 +70,44 @@ extern "C"
      */
     const char *oreja_mobile_version();
 
+    /**
+     * Habilitar o deshabilitar el snapshot de arranque (llamar antes de oreja_mobile_init)
+     * @param habilitado 1 = usar y regenerar el snapshot (por defecto), 0 = cargar siempre las fuentes
+     * @param ruta Ruta del snapshot (NULL = <model_dir>/oreja_snapshot.bin)
+     * @return 0 si exito, -1 si error
+     */
+    int oreja_mobile_configurar_snapshot(int habilitado, const char *ruta);
+
+    /**
+     * Borrar el snapshot de arranque para forzar su regeneracion en el proximo init
+     * @return 0 si exito (o si no existia), -1 si error
+     */
+    int oreja_mobile_invalidar_snapshot();
+
     /**
      * Recargar templates desde disco (templates_k1.csv)
      * @return 0 si exito, -1 si error
      */
     int oreja_mobile_reload_templates();
 
+    /**
+     * Configurar el tamaño de la arena de trabajo
+     * Decodificacion de imagen, extraccion, proyeccion z-score/PCA/LDA,
+     * comparacion de templates y armado del resultado usan una arena que se
+     * reinicia al final de cada peticion.
+     * @param bytes Capacidad inicial (0 = por defecto, 4 MB)
+     * @return 0 si exito, -1 si error
+     */
+    int oreja_mobile_configurar_arena(size_t bytes);
+
+    /**
+     * Contador de asignaciones de heap hechas por la libreria desde el arranque
+     * Sirve para comprobar que oreja_mobile_autenticar no asigna en estado
+     * estable. Solo disponible si se compila con OREJA_MOBILE_CONTAR_ASIGNACIONES.
+     * @return Cantidad de asignaciones, -1 si el contador no esta compilado
+     */
+    int64_t oreja_mobile_contador_asignaciones();
+
     // ============================================================================
     // REGISTRO BIOMETRICO
     // ============================================================================
@@ -57,6 +120,7 @@ extern "C"
      * @param resultado_json Buffer donde se copiara el resultado JSON
      * @param buffer_size Tamaño del buffer de resultado
      * @return 0 si exito, -1 si error
+     *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
      */
     int oreja_mobile_registrar_biometria(int identificador_unico,
                                          const char **image_paths,
@@ -76,6 +140,7 @@ extern "C"
      * @param resultado_json Buffer donde se copiara el resultado JSON
      * @param buffer_size Tamaño del buffer de resultado
      * @return 1 si autenticado, 0 si rechazado, -1 si error
+     *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
      */
     int oreja_mobile_autenticar(int identificador_claimed,
                                 const char *image_path,
@@ -83,6 +148,72 @@ extern "C"
                                 char *resultado_json,
                                 size_t buffer_size);
 
+    // ============================================================================
+    // RESULTADOS BINARIOS
+    // ============================================================================
+
+    /** Tiempos por etapa de una peticion, en milisegundos */
+    typedef struct oreja_tiempos
+    {
+        double decodificacion_ms;   // Lectura y decodificacion de la imagen
+        double extraccion_ms;       // Extraccion de caracteristicas
+        double proyeccion_ms;       // z-score + PCA + LDA
+        double comparacion_ms;      // Comparacion contra templates
+        double total_ms;
+    } oreja_tiempos;
+
+    /** Resultado de autenticacion 1:1 */
+    typedef struct oreja_resultado_auth
+    {
+        uint32_t struct_size;       // sizeof(oreja_resultado_auth), lo pone el llamador
+        int32_t autenticado;        // 1 si autenticado, 0 si rechazado
+        int32_t clase_reclamada;
+        int32_t clase_predicha;     // Template mas cercano
+        double score;               // Score contra el template de la clase reclamada
+        double umbral;              // Umbral efectivamente aplicado
+        oreja_tiempos tiempos;
+    } oreja_resultado_auth;
+
+    /**
+     * Autenticar usuario por oreja (1:1) con resultado binario
+     * El llamador debe poner resultado->struct_size = sizeof(oreja_resultado_auth).
+     * @param identificador_claimed ID del usuario a verificar
+     * @param image_path Ruta a la imagen (JPG/PNG)
+     * @param umbral Umbral de verificacion (si <0, usa umbral_eer.txt o 0.5)
+     * @param resultado Struct del llamador
+     * @return 1 si autenticado, 0 si rechazado, -1 si error
+     */
+    int oreja_mobile_autenticar_bin(int identificador_claimed,
+                                    const char *image_path,
+                                    double umbral,
+                                    oreja_resultado_auth *resultado);
+
+    // ============================================================================
+    // EVALUACION OFFLINE
+    // ============================================================================
+
+    /**
+     * Evaluar el modelo cargado sobre un dataset LDA
+     * El CSV (ej: caracteristicas_lda_train.csv) se mapea con mmap y cada
+     * vector se compara contra todos los templates en paralelo.
+     * resultado_json recibe el resumen:
+     *   {"muestras", "accuracy", "eer", "umbral_eer", "far_en_umbral", "frr_en_umbral", "tiempo_ms"}
+     * Si reporte_path no es NULL se escribe ademas el reporte completo con
+     * "confusion" ([[clase_real, clase_predicha, cantidad], ...]) y
+     * "roc" ([{"umbral", "far", "frr"}, ...]).
+     * @param dataset_csv Ruta al CSV de caracteristicas LDA
+     * @param num_puntos_roc Puntos de la curva ROC/DET (<= 0 usa 100)
+     * @param reporte_path Ruta del JSON con el reporte completo (NULL = solo resumen)
+     * @param resultado_json Buffer donde se copiara el resumen JSON
+     * @param buffer_size Tamaño del buffer
+     * @return Cantidad de muestras evaluadas, -1 si error, OREJA_ERROR_BUFFER_PEQUENO si el buffer no alcanza
+     */
+    int oreja_mobile_evaluar(const char *dataset_csv,
+                             int num_puntos_roc,
+                             const char *reporte_path,
+                             char *resultado_json,
+                             size_t buffer_size);
+
     // ============================================================================
     // UTILIDADES
     // ============================================================================
@@ -95,13 +226,66 @@ extern "C"
     void oreja_mobile_obtener_ultimo_error(char *buffer, size_t buffer_size);
 
     /**
-     * Obtener estadisticas del modelo
+     * Obtener estadisticas del modelo y latencias por etapa
+     * Ademas de las estadisticas del modelo incluye "latencias": por cada etapa
+     * ("decodificacion", "extraccion", "proyeccion", "comparacion")
+     * {"conteo", "p50_ms", "p95_ms", "p99_ms", "max_ms"}, registradas con
+     * contadores por hilo sin locks en histogramas de buckets logaritmicos.
      * @param stats_json Buffer donde se copiara el JSON con estadisticas
      * @param buffer_size Tamaño del buffer
-     * @return 0 si exito, -1 si error
+     * @return 0 si exito, -1 si error, OREJA_ERROR_BUFFER_PEQUENO si el buffer no alcanza
      */
     int oreja_mobile_obtener_estadisticas(char *stats_json, size_t buffer_size);
 
+    /**
+     * Reiniciar los histogramas de latencia (no afecta al modelo)
+     */
+    void oreja_mobile_reiniciar_estadisticas();
+
+    /**
+     * Habilitar el trazado de spans (formato Chrome trace / Perfetto)
+     * Registra spans de init, registro, autenticacion (decodificacion,
+     * extraccion, proyeccion, comparacion) y sync en un buffer circular sin
+     * locks. Cada span se escribe al cerrarse como evento completo ("ph": "X"
+     * con "ts", "dur" e id de hilo), asi el wrap solo descarta spans enteros.
+     * Deshabilitado, cada span cuesta una lectura atomica.
+     * @param capacidad_eventos Tamaño del buffer circular (0 = por defecto, 65536)
+     * @return 0 si exito, -1 si error
+     */
+    int oreja_mobile_traza_habilitar(size_t capacidad_eventos);
+
+    /**
+     * Deshabilitar el trazado (los eventos ya registrados se conservan)
+     */
+    void oreja_mobile_traza_deshabilitar();
+
+    /**
+     * Exportar los eventos registrados como JSON de Chrome trace
+     * @param ruta_json Ruta del archivo a escribir
+     * @param limpiar Si es 1, vacia el buffer despues de exportar
+     * @return Cantidad de eventos exportados, -1 si error
+     */
+    int oreja_mobile_traza_exportar(const char *ruta_json, int limpiar);
+
+    /**
+     * Copiar un resultado JSON truncado por su id
+     * El id viene en "id_resultado" del JSON truncado (ver CODIGOS DE
+     * RETORNO), por lo que cada llamada recupera el suyo aunque varios
+     * isolates usen la libreria a la vez. El resultado se descarta tras
+     * copiarlo con exito; la libreria conserva los ultimos 32 sin reclamar
+     * y descarta los mas antiguos.
+     * @param id_resultado Id recibido en el JSON truncado
+     * @param resultado_json Buffer destino (NULL = solo consultar el tamaño)
+     * @param buffer_size Tamaño del buffer
+     * @param tamano_requerido Si no es NULL, recibe los bytes necesarios incluyendo el '\0'
+     * @return 0 si exito, OREJA_ERROR_BUFFER_PEQUENO si no cabe, -1 si el id
+     *         no existe o ya fue copiado o descartado
+     */
+    int oreja_mobile_copiar_resultado(int64_t id_resultado,
+                                      char *resultado_json,
+                                      size_t buffer_size,
+                                      size_t *tamano_requerido);
+
 // ============================================================================
 // SINCRONIZACION
 // ============================================================================
@@ -112,6 +296,7 @@ extern "C"
  * @param resultado_json Buffer donde se copiara el resultado JSON
  * @param buffer_size Tamaño del buffer
  * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
  */
 int oreja_mobile_sync_push(const char *server_url, char *resultado_json, size_t buffer_size);
 
@@ -122,6 +307,7 @@ int oreja_mobile_sync_push(const char *server_url, char *resultado_json, size_t
  * @param resultado_json Buffer donde se copiara el resultado JSON
  * @param buffer_size Tamaño del buffer
  * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
  */
 int oreja_mobile_sync_pull(const char *server_url, const char *desde, char *resultado_json, size_t buffer_size);
 
@@ -132,6 +318,7 @@ int oreja_mobile_sync_pull(const char *server_url, const char *desde, char *resu
  * @param resultado_json Buffer donde se copiara el resultado JSON
  * @param buffer_size Tamaño del buffer
  * @return 0 si exito, -1 si error
+ *         (un buffer insuficiente no cambia el retorno, ver CODIGOS DE RETORNO)
  */
 int oreja_mobile_sync_modelo(const char *server_url, const char *archivo, char *resultado_json, size_t buffer_size);
 
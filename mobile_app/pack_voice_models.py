@@ -0,0 +1,509 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Empaqueta los modelos SVM de voz (metadata.json + class_<id>.bin) en un solo
+archivo modelo_voz.vzpk que libvoz_mobile carga con mmap.
+
+El formato esta documentado en
+lib/entrega_flutter_mobile/apis/voz_model_pack.h
+
+Los tipos cuantizados (f16, i8) solo se escriben si pasan la compuerta de
+precision: se evalua el modelo float64 y el cuantizado sobre
+caracteristicas_test.dat y se rechaza el cuantizado si la accuracy o el EER
+se alejan mas de --max-deriva (valor absoluto, 0.01 = 1 punto porcentual).
+
+--train (obligatorio al empaquetar) indica caracteristicas_train.dat, del
+que se calculan las estadisticas de impostores por clase (Z-norm) y el
+vector medio de cada clase que usa el registro incremental.
+
+Uso:
+    python3 pack_voice_models.py assets/models/v1 \\
+        --train assets/caracteristicas/v1/caracteristicas_train.dat
+    python3 pack_voice_models.py assets/models/v1 -o /tmp/modelo_voz.vzpk \\
+        --train assets/caracteristicas/v1/caracteristicas_train.dat
+    python3 pack_voice_models.py assets/models/v1 --tipo i8 \\
+        --train assets/caracteristicas/v1/caracteristicas_train.dat \\
+        --test assets/caracteristicas/v1/caracteristicas_test.dat
+    python3 pack_voice_models.py --verificar assets/models/v1/modelo_voz.vzpk assets/models/v1
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = b'VZPK'
+VERSION = 2
+ALIGNMENT = 64
+HEADER_SIZE = 96
+HEADER_FMT = '<4s5I4Q4I3Q'
+CHECKSUM_OFFSET = 56   # uint32 checksum dentro de la cabecera
+NORM_FMT = '<3d'
+F16_MAX = 65504.0  # mayor valor finito de float16
+NORM_SIZE = 24
+FILENAME = 'modelo_voz.vzpk'
+
+# nombre -> (weight_type, formato struct, bytes por elemento)
+TIPOS = {
+    'f64': (0, 'd', 8),
+    'f16': (1, 'e', 2),
+    'i8': (2, 'b', 1),
+}
+TIPO_INT8 = TIPOS['i8'][0]
+
+MAX_DERIVA_DEFAULT = 0.01
+
+
+def _align(valor, alineacion):
+    return (valor + alineacion - 1) // alineacion * alineacion
+
+
+def _crc_paquete(data):
+    """CRC-32 de cabecera + cuerpo con el campo checksum en cero"""
+    crc = zlib.crc32(data[:CHECKSUM_OFFSET])
+    crc = zlib.crc32(b'\0\0\0\0', crc)
+    return zlib.crc32(data[CHECKSUM_OFFSET + 4:], crc) & 0xFFFFFFFF
+
+
+def _tipo_por_codigo(codigo):
+    for nombre, (cod, fmt, size) in TIPOS.items():
+        if cod == codigo:
+            return nombre, fmt, size
+    raise ValueError('weight_type desconocido: %d' % codigo)
+
+
+def leer_clase(model_dir, class_id, dimension):
+    """Lee class_<id>.bin: uint32 dim, double w[dim], double bias, 3 doubles reservados.
+    Devuelve tambien los bytes crudos para el CRC de fuentes."""
+    path = os.path.join(model_dir, 'class_%d.bin' % class_id)
+    with open(path, 'rb') as f:
+        data = f.read()
+    if len(data) < 4:
+        raise ValueError('%s: archivo truncado (%d bytes)' % (path, len(data)))
+    (dim,) = struct.unpack_from('<I', data, 0)
+    if dim != dimension:
+        raise ValueError('%s: dimension %d != %d' % (path, dim, dimension))
+    if len(data) < 4 + 8 * (dim + 1):
+        raise ValueError('%s: archivo truncado (%d bytes)' % (path, len(data)))
+    pesos = struct.unpack_from('<%dd' % dim, data, 4)
+    (bias,) = struct.unpack_from('<d', data, 4 + 8 * dim)
+    return pesos, bias, data
+
+
+def leer_modelos(model_dir):
+    with open(os.path.join(model_dir, 'metadata.json'), 'rb') as f:
+        crudo = f.read()
+    metadata = json.loads(crudo.decode('utf-8'))
+    source_crc = zlib.crc32(crudo)
+
+    dimension = int(metadata['dimension'])
+    class_ids = sorted(int(c) for c in metadata['classes'])
+    if len(class_ids) != int(metadata.get('num_classes', len(class_ids))):
+        raise ValueError('metadata.json: num_classes no coincide con classes')
+
+    pesos, bias = [], []
+    for class_id in class_ids:
+        w, b, data = leer_clase(model_dir, class_id, dimension)
+        pesos.append(w)
+        bias.append(b)
+        source_crc = zlib.crc32(data, source_crc)
+
+    # Los class_<id>.bin no tienen version; el paquete parte de metadata.json o 0
+    model_version = int(metadata.get('version_modelo', 0))
+    return {
+        'dimension': dimension,
+        'class_ids': class_ids,
+        'pesos': pesos,
+        'bias': bias,
+        'scales': None,
+        'norm': None,
+        'means': None,
+        'model_version': model_version,
+        'source_crc': source_crc & 0xFFFFFFFF,
+    }
+
+
+def cuantizar_fila(pesos, tipo):
+    """Devuelve (valores almacenados, escala). La escala solo aplica a i8."""
+    if tipo == 'f64':
+        return list(pesos), 1.0
+    if tipo == 'f16':
+        maximo = max(abs(w) for w in pesos)
+        if maximo > F16_MAX:
+            raise ValueError('peso %g fuera del rango de float16 (|w| <= %g): use --tipo i8 o f64'
+                             % (maximo, F16_MAX))
+        return [struct.unpack('<e', struct.pack('<e', w))[0] for w in pesos], 1.0
+    maximo = max(abs(w) for w in pesos)
+    escala = maximo / 127.0 if maximo > 0 else 1.0
+    return [max(-127, min(127, int(round(w / escala)))) for w in pesos], escala
+
+
+def cuantizar(modelo, tipo):
+    """Modelo con los pesos en el tipo destino (i8 queda como enteros + scales)"""
+    pesos, scales = [], []
+    for fila in modelo['pesos']:
+        q, escala = cuantizar_fila(fila, tipo)
+        pesos.append(q)
+        scales.append(escala)
+    cuantizado = dict(modelo)
+    cuantizado['pesos'] = pesos
+    cuantizado['scales'] = scales if tipo == 'i8' else None
+    return cuantizado
+
+
+def empaquetar(modelo, tipo):
+    weight_type, fmt, elem_size = TIPOS[tipo]
+    dimension = modelo['dimension']
+    class_ids = modelo['class_ids']
+    num_classes = len(class_ids)
+    row_stride = _align(dimension, ALIGNMENT // elem_size)
+
+    class_ids_offset = HEADER_SIZE
+    weights_offset = _align(class_ids_offset + 4 * num_classes, ALIGNMENT)
+    bias_offset = weights_offset + elem_size * row_stride * num_classes
+    scales_offset = bias_offset + 8 * num_classes if tipo == 'i8' else 0
+    fin = (scales_offset or bias_offset) + 8 * num_classes
+    norm_offset = fin if modelo['norm'] else 0
+    fin += NORM_SIZE * num_classes if norm_offset else 0
+    means_offset = fin if modelo['means'] else 0
+    file_size = fin + (8 * (dimension + 1) * num_classes if means_offset else 0)
+
+    cuerpo = bytearray(file_size - HEADER_SIZE)
+    struct.pack_into('<%di' % num_classes, cuerpo, class_ids_offset - HEADER_SIZE, *class_ids)
+
+    relleno = [0] * (row_stride - dimension)
+    for i in range(num_classes):
+        struct.pack_into('<%d%s' % (row_stride, fmt), cuerpo,
+                         weights_offset - HEADER_SIZE + elem_size * row_stride * i,
+                         *(list(modelo['pesos'][i]) + relleno))
+        struct.pack_into('<d', cuerpo, bias_offset - HEADER_SIZE + 8 * i, modelo['bias'][i])
+        if scales_offset:
+            struct.pack_into('<d', cuerpo, scales_offset - HEADER_SIZE + 8 * i, modelo['scales'][i])
+        if norm_offset:
+            struct.pack_into(NORM_FMT, cuerpo, norm_offset - HEADER_SIZE + NORM_SIZE * i,
+                             *modelo['norm'][i])
+        if means_offset:
+            media, cantidad = modelo['means'][i]
+            struct.pack_into('<%dd' % dimension, cuerpo,
+                             means_offset - HEADER_SIZE + 8 * dimension * i, *media)
+            struct.pack_into('<d', cuerpo,
+                             means_offset - HEADER_SIZE + 8 * dimension * num_classes + 8 * i,
+                             cantidad)
+
+    header = struct.pack(HEADER_FMT, MAGIC, VERSION, dimension, num_classes,
+                         row_stride, ALIGNMENT, class_ids_offset, weights_offset,
+                         bias_offset, file_size, 0, modelo['model_version'],
+                         weight_type, modelo['source_crc'], scales_offset, norm_offset,
+                         means_offset)
+    assert len(header) == HEADER_SIZE
+    data = bytearray(header + bytes(cuerpo))
+    struct.pack_into('<I', data, CHECKSUM_OFFSET, _crc_paquete(data))
+    return bytes(data)
+
+
+def leer_pack(pack_path):
+    """Lee un .vzpk y devuelve el modelo con los pesos almacenados"""
+    with open(pack_path, 'rb') as f:
+        data = f.read()
+
+    if len(data) < HEADER_SIZE:
+        raise ValueError('archivo truncado (%d bytes)' % len(data))
+    campos = struct.unpack_from(HEADER_FMT, data, 0)
+    (magic, version) = campos[:2]
+    if magic != MAGIC or version != VERSION:
+        raise ValueError('cabecera invalida (magic=%r, version=%d)' % (magic, version))
+
+    (_, _, dimension, num_classes, row_stride, alignment,
+     class_ids_offset, weights_offset, bias_offset, file_size,
+     checksum, model_version, weight_type, source_crc, scales_offset, norm_offset,
+     means_offset) = campos
+
+    if file_size != len(data):
+        raise ValueError('tamaño %d != %d' % (len(data), file_size))
+    if _crc_paquete(data) != checksum:
+        raise ValueError('checksum invalido')
+
+    # El checksum no protege de un escritor con errores: se valida toda la
+    # geometria antes de leer con ella
+    tipo, fmt, elem_size = _tipo_por_codigo(weight_type)
+    if (weight_type == TIPO_INT8) != (scales_offset != 0):
+        raise ValueError('scales_offset inconsistente con weight_type')
+    if alignment == 0 or alignment & (alignment - 1) or alignment % elem_size:
+        raise ValueError('alignment invalido: %d' % alignment)
+    if weights_offset % alignment != 0:
+        raise ValueError('weights no alineados a %d bytes' % alignment)
+    if dimension == 0 or num_classes == 0 or row_stride < dimension:
+        raise ValueError('dimension=%d num_classes=%d row_stride=%d invalidos'
+                         % (dimension, num_classes, row_stride))
+
+    def _region(nombre, offset, tamano, minimo):
+        if offset < minimo or offset + tamano > file_size:
+            raise ValueError('%s fuera del archivo (offset %d, %d bytes)' % (nombre, offset, tamano))
+        return offset + tamano
+
+    fin = _region('class_ids', class_ids_offset, 4 * num_classes, HEADER_SIZE)
+    fin = _region('weights', weights_offset, elem_size * row_stride * num_classes, fin)
+    fin = _region('bias', bias_offset, 8 * num_classes, fin)
+    if scales_offset:
+        fin = _region('scales', scales_offset, 8 * num_classes, fin)
+    if norm_offset:
+        fin = _region('norm', norm_offset, NORM_SIZE * num_classes, fin)
+    if means_offset:
+        _region('means', means_offset, 8 * (dimension + 1) * num_classes, fin)
+
+    class_ids = list(struct.unpack_from('<%di' % num_classes, data, class_ids_offset))
+    pesos = [struct.unpack_from('<%d%s' % (dimension, fmt), data,
+                                weights_offset + elem_size * row_stride * i)
+             for i in range(num_classes)]
+    bias = list(struct.unpack_from('<%dd' % num_classes, data, bias_offset))
+    scales = (list(struct.unpack_from('<%dd' % num_classes, data, scales_offset))
+              if scales_offset else None)
+    norm = ([struct.unpack_from(NORM_FMT, data, norm_offset + NORM_SIZE * i)
+             for i in range(num_classes)] if norm_offset else None)
+    counts_offset = means_offset + 8 * dimension * num_classes
+    means = ([(struct.unpack_from('<%dd' % dimension, data, means_offset + 8 * dimension * i),
+               struct.unpack_from('<d', data, counts_offset + 8 * i)[0])
+              for i in range(num_classes)] if means_offset else None)
+
+    return tipo, {
+        'dimension': dimension,
+        'class_ids': class_ids,
+        'pesos': pesos,
+        'bias': bias,
+        'scales': scales,
+        'norm': norm,
+        'means': means,
+        'model_version': model_version,
+        'source_crc': source_crc,
+    }
+
+
+def verificar(pack_path, model_dir):
+    tipo, pack = leer_pack(pack_path)
+    original = leer_modelos(model_dir)
+    esperado = cuantizar(original, tipo)
+
+    if pack['source_crc'] and pack['source_crc'] != original['source_crc']:
+        raise ValueError('paquete desactualizado: source_crc %08x != %08x'
+                         % (pack['source_crc'], original['source_crc']))
+    if pack['class_ids'] != esperado['class_ids'] or pack['dimension'] != esperado['dimension']:
+        raise ValueError('clases o dimension no coinciden con metadata.json')
+    for i, class_id in enumerate(pack['class_ids']):
+        if (list(pack['pesos'][i]) != list(esperado['pesos'][i])
+                or pack['bias'][i] != esperado['bias'][i]
+                or (pack['scales'] and pack['scales'][i] != esperado['scales'][i])):
+            raise ValueError('clase %d no coincide con class_%d.bin' % (class_id, class_id))
+        if pack['norm'] and not pack['norm'][i][1] > 0:
+            raise ValueError('clase %d: desviacion Z-norm invalida' % class_id)
+        if pack['means'] and not pack['means'][i][1] > 0:
+            raise ValueError('clase %d: media sin muestras' % class_id)
+
+    return tipo, len(pack['class_ids']), pack['dimension']
+
+
+# ============================================================================
+# COMPUERTA DE PRECISION
+# ============================================================================
+
+def leer_caracteristicas(path, dimension):
+    """caracteristicas_*.dat: registros de uint32 dim, double x[dim], int32 clase"""
+    with open(path, 'rb') as f:
+        data = f.read()
+    registro = 4 + 8 * dimension + 4
+    if len(data) % registro != 0:
+        raise ValueError('%s: tamaño no es multiplo de %d' % (path, registro))
+    muestras = []
+    for offset in range(0, len(data), registro):
+        (dim,) = struct.unpack_from('<I', data, offset)
+        if dim != dimension:
+            raise ValueError('%s: dimension %d != %d' % (path, dim, dimension))
+        x = struct.unpack_from('<%dd' % dim, data, offset + 4)
+        (clase,) = struct.unpack_from('<i', data, offset + 4 + 8 * dim)
+        muestras.append((x, clase))
+    return muestras
+
+
+def puntuar(modelo, x):
+    """Scores de todas las clases, replicando los kernels de la libreria"""
+    if modelo['scales'] is None:
+        return [sum(w * v for w, v in zip(fila, x)) + b
+                for fila, b in zip(modelo['pesos'], modelo['bias'])]
+
+    # int8: el vector de entrada tambien se cuantiza (escala dinamica por peticion)
+    maximo = max(abs(v) for v in x)
+    escala_x = maximo / 127.0 if maximo > 0 else 1.0
+    qx = [max(-127, min(127, int(round(v / escala_x)))) for v in x]
+    return [escala_x * s * sum(w * v for w, v in zip(fila, qx)) + b
+            for fila, b, s in zip(modelo['pesos'], modelo['bias'], modelo['scales'])]
+
+
+def calcular_eer(genuinos, impostores):
+    puntos = sorted([(s, 1) for s in genuinos] + [(s, 0) for s in impostores], reverse=True)
+    aceptados_gen, aceptados_imp = 0, 0
+    mejor = (0.0, 1.0)  # umbral por encima de todos los scores: FAR=0, FRR=1
+    for score, es_genuino in puntos:
+        if es_genuino:
+            aceptados_gen += 1
+        else:
+            aceptados_imp += 1
+        far = aceptados_imp / len(impostores)
+        frr = 1.0 - aceptados_gen / len(genuinos)
+        if abs(far - frr) < abs(mejor[0] - mejor[1]):
+            mejor = (far, frr)
+    return (mejor[0] + mejor[1]) / 2.0
+
+
+def evaluar(modelo, muestras):
+    indice = {c: i for i, c in enumerate(modelo['class_ids'])}
+    aciertos, genuinos, impostores = 0, [], []
+    for x, clase in muestras:
+        scores = puntuar(modelo, x)
+        mejor = max(range(len(scores)), key=scores.__getitem__)
+        if modelo['class_ids'][mejor] == clase:
+            aciertos += 1
+        if clase in indice:
+            genuinos.append(scores[indice[clase]])
+            impostores.extend(s for i, s in enumerate(scores) if i != indice[clase])
+    accuracy = aciertos / len(muestras) if muestras else 0.0
+    eer = calcular_eer(genuinos, impostores) if genuinos and impostores else 0.0
+    return accuracy, eer
+
+
+def compuerta_precision(original, cuantizado, test_path, max_deriva):
+    muestras = leer_caracteristicas(test_path, original['dimension'])
+    acc_ref, eer_ref = evaluar(original, muestras)
+    acc_q, eer_q = evaluar(cuantizado, muestras)
+    print('📊 float64:     accuracy=%.4f  EER=%.4f' % (acc_ref, eer_ref))
+    print('📊 cuantizado:  accuracy=%.4f  EER=%.4f' % (acc_q, eer_q))
+    deriva = max(abs(acc_ref - acc_q), abs(eer_ref - eer_q))
+    return deriva <= max_deriva, deriva
+
+
+# ============================================================================
+# NORMALIZACION DE SCORES (Z-NORM)
+# ============================================================================
+
+def calcular_znorm(modelo, train_path):
+    """Media/desviacion de los scores de impostores de cada clase sobre el train"""
+    muestras = leer_caracteristicas(train_path, modelo['dimension'])
+    num_classes = len(modelo['class_ids'])
+    indice = {c: i for i, c in enumerate(modelo['class_ids'])}
+    suma = [0.0] * num_classes
+    suma2 = [0.0] * num_classes
+    cantidad = [0] * num_classes
+    for x, clase in muestras:
+        propia = indice.get(clase)
+        for i, score in enumerate(puntuar(modelo, x)):
+            if i == propia:
+                continue
+            suma[i] += score
+            suma2[i] += score * score
+            cantidad[i] += 1
+
+    norm = []
+    for i in range(num_classes):
+        if cantidad[i] < 2:
+            raise ValueError('clase %d: sin impostores suficientes en %s'
+                             % (modelo['class_ids'][i], train_path))
+        media = suma[i] / cantidad[i]
+        varianza = max(suma2[i] / cantidad[i] - media * media, 0.0)
+        norm.append((media, max(varianza ** 0.5, 1e-9), float(cantidad[i])))
+    return norm
+
+
+def calcular_medias(modelo, train_path):
+    """Vector medio y cantidad de muestras de cada clase sobre el train"""
+    muestras = leer_caracteristicas(train_path, modelo['dimension'])
+    indice = {c: i for i, c in enumerate(modelo['class_ids'])}
+    suma = [[0.0] * modelo['dimension'] for _ in modelo['class_ids']]
+    cantidad = [0] * len(modelo['class_ids'])
+    for x, clase in muestras:
+        i = indice.get(clase)
+        if i is None:
+            continue
+        fila = suma[i]
+        for j, v in enumerate(x):
+            fila[j] += v
+        cantidad[i] += 1
+
+    medias = []
+    for i, class_id in enumerate(modelo['class_ids']):
+        if cantidad[i] == 0:
+            raise ValueError('clase %d: sin muestras en %s' % (class_id, train_path))
+        medias.append(([v / cantidad[i] for v in suma[i]], float(cantidad[i])))
+    return medias
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Empaquetar modelos SVM de voz en modelo_voz.vzpk')
+    parser.add_argument('model_dir', nargs='?', help='Directorio con metadata.json y class_<id>.bin')
+    parser.add_argument('-o', '--output', help='Archivo de salida (por defecto <model_dir>/%s)' % FILENAME)
+    parser.add_argument('--tipo', choices=sorted(TIPOS), default='f64',
+                        help='Tipo de los pesos (f16 e i8 requieren --test)')
+    parser.add_argument('--test', help='caracteristicas_test.dat para la compuerta de precision')
+    parser.add_argument('--max-deriva', type=float, default=MAX_DERIVA_DEFAULT,
+                        help='Deriva maxima admitida en accuracy/EER (default %.2f)' % MAX_DERIVA_DEFAULT)
+    parser.add_argument('--train', help='caracteristicas_train.dat para calcular Z-norm y medias por clase '
+                                        '(obligatorio al empaquetar)')
+    parser.add_argument('--verificar', nargs=2, metavar=('PACK', 'MODEL_DIR'),
+                        help='Comparar un .vzpk existente con los class_<id>.bin originales')
+    args = parser.parse_args()
+
+    try:
+        if args.verificar:
+            tipo, num_classes, dimension = verificar(*args.verificar)
+            print('✅ %s valido (%s): %d clases x %d' % (args.verificar[0], tipo, num_classes, dimension))
+            return 0
+
+        if not args.model_dir:
+            parser.error('falta model_dir')
+        if not args.train:
+            parser.error('falta --train: el paquete debe incluir Z-norm y medias por clase')
+        if args.tipo != 'f64' and not args.test:
+            parser.error('--tipo %s requiere --test para la compuerta de precision' % args.tipo)
+
+        original = leer_modelos(args.model_dir)
+        modelo = cuantizar(original, args.tipo)
+
+        if args.tipo != 'f64':
+            ok, deriva = compuerta_precision(original, modelo, args.test, args.max_deriva)
+            if not ok:
+                print('❌ Modelo %s rechazado: deriva %.4f > %.4f' % (args.tipo, deriva, args.max_deriva),
+                      file=sys.stderr)
+                return 2
+            print('✅ Deriva %.4f <= %.4f' % (deriva, args.max_deriva))
+
+        # Se calculan con los pesos ya cuantizados: son los scores que vera la libreria
+        modelo['norm'] = calcular_znorm(modelo, args.train)
+        print('📊 Z-norm calculado para %d clases' % len(modelo['norm']))
+        modelo['means'] = calcular_medias(modelo, args.train)
+        print('📊 Medias calculadas para %d clases' % len(modelo['means']))
+
+        output = args.output or os.path.join(args.model_dir, FILENAME)
+        data = empaquetar(modelo, args.tipo)
+
+        # Escritura atomica: el loader nunca debe mapear un archivo a medias,
+        # y un paquete que no pasa la verificacion no reemplaza al anterior
+        tmp = output + '.tmp'
+        with open(tmp, 'wb') as f:
+            f.write(data)
+            f.flush()
+            os.fsync(f.fileno())
+        try:
+            tipo, num_classes, dimension = verificar(tmp, args.model_dir)
+        except Exception:
+            os.remove(tmp)
+            raise
+        os.replace(tmp, output)
+
+        print('✅ %s (%s): %d clases x %d (%d bytes)' % (output, tipo, num_classes, dimension, len(data)))
+        return 0
+    except (OSError, ValueError, KeyError, struct.error) as e:
+        print('❌ Error: %s' % e, file=sys.stderr)
+        return 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())